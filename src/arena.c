@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "mem.h"
+
+#define ARENA_ALIGN 16
+
+bool arenaInit(Arena *arena, size_t capacity)
+{
+	arena->base = memAlloc(capacity);
+	arena->capacity = arena->base ? capacity : 0;
+	arena->used = 0;
+	return arena->base != NULL;
+}
+
+void arenaFree(Arena *arena)
+{
+	memFree(arena->base);
+	arena->base = NULL;
+	arena->capacity = 0;
+	arena->used = 0;
+}
+
+void* arenaAlloc(Arena *arena, size_t bytes)
+{
+	size_t start = (arena->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (start + bytes > arena->capacity)
+	{
+		fprintf(stderr, "Arena exhausted: %zu of %zu bytes used, %zu asked\n",
+		        arena->used, arena->capacity, bytes);
+		abort();
+	}
+	arena->used = start + bytes;
+	return arena->base + start;
+}
+
+size_t arenaMark(Arena *arena)
+{
+	return arena->used;
+}
+
+void arenaReset(Arena *arena, size_t mark)
+{
+	arena->used = mark;
+}
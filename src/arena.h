@@ -0,0 +1,29 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// bump allocator: one block up front, allocations are released all at once
+// with arenaReset or arenaFree
+typedef struct
+{
+	u8 *base;
+	size_t capacity;
+	size_t used;
+} Arena;
+
+bool arenaInit(Arena *arena, size_t capacity);
+
+void arenaFree(Arena *arena);
+
+// never returns NULL: every arena is sized up front for all its owner
+// carves from it, so running out is a bug and aborts
+void* arenaAlloc(Arena *arena, size_t bytes);
+
+size_t arenaMark(Arena *arena);
+
+void arenaReset(Arena *arena, size_t mark);
+
+#endif
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio.h"
+#include "mem.h"
+
+// whether the mixer can decode files with extension
+static bool audioDecodes(Audio *audio, const char *extension)
+{
+	if (strcmp(extension, ".opus") == 0)
+		return audio->formats & MIX_INIT_OPUS;
+	if (strcmp(extension, ".ogg") == 0)
+		return audio->formats & MIX_INIT_OGG;
+	return true;
+}
+
+// Finds name in AUDIO_DIR with the first of extensions, count of them,
+// that exists and can be decoded. Returns the file's size, or -1 with
+// path untouched if there is none.
+static i64 audioFind(Audio *audio, const char *name,
+                     const char **extensions, u32 count,
+                     char *path, size_t pathSize)
+{
+	for (u32 i = 0; i < count; i++)
+	{
+		if (!audioDecodes(audio, extensions[i]))
+			continue;
+
+		char candidate[256];
+		snprintf(candidate, sizeof(candidate), "%s%s%s",
+		         AUDIO_DIR, name, extensions[i]);
+		FILE *file = fopen(candidate, "rb");
+		if (!file)
+			continue;
+
+		fseek(file, 0, SEEK_END);
+		i64 size = ftell(file);
+		fclose(file);
+		snprintf(path, pathSize, "%s", candidate);
+		return size;
+	}
+	return -1;
+}
+
+bool audioInit(Audio *audio, const char **effectNames, i32 numEffects)
+{
+	*audio = (Audio){0};
+
+	// without a decoder only the .wav files play
+	i32 formats = MIX_INIT_OGG | MIX_INIT_OPUS;
+	audio->formats = Mix_Init(formats);
+	if ((audio->formats & formats) != formats)
+	{
+		fprintf(stderr, "Compressed audio partly unavailable: %s\n",
+		        Mix_GetError());
+	}
+	const char *extensions[] = AUDIO_EFFECT_EXTENSIONS;
+
+	// decoded on their own first, the pool is sized once they all are
+	Mix_Chunk **decoded = memCalloc(numEffects, sizeof(Mix_Chunk*));
+	u32 poolSize = 0;
+	bool loaded = true;
+	for (i32 i = 0; i < numEffects && loaded; i++)
+	{
+		char path[256];
+		if (audioFind(audio, effectNames[i], extensions,
+		              sizeof(extensions) / sizeof(extensions[0]),
+		              path, sizeof(path)) < 0)
+		{
+			fprintf(stderr, "No sound file for %s in %s\n",
+			        effectNames[i], AUDIO_DIR);
+			loaded = false;
+			break;
+		}
+		decoded[i] = Mix_LoadWAV(path);
+		if (!decoded[i])
+		{
+			fprintf(stderr, "Failed to load %s: %s\n", path, Mix_GetError());
+			loaded = false;
+			break;
+		}
+		poolSize += decoded[i]->alen;
+	}
+
+	if (loaded)
+	{
+		audio->pool = memAlloc(poolSize);
+		audio->poolSize = poolSize;
+		audio->effects = memCalloc(numEffects, sizeof(Mix_Chunk*));
+		audio->numEffects = numEffects;
+
+		u32 offset = 0;
+		for (i32 i = 0; i < numEffects; i++)
+		{
+			memcpy(audio->pool + offset, decoded[i]->abuf, decoded[i]->alen);
+			audio->effects[i]
+			    = Mix_QuickLoad_RAW(audio->pool + offset, decoded[i]->alen);
+			audio->effects[i]->volume = decoded[i]->volume;
+			offset += decoded[i]->alen;
+		}
+	}
+
+	for (i32 i = 0; i < numEffects; i++)
+	{
+		if (decoded[i])
+			Mix_FreeChunk(decoded[i]);
+	}
+	memFree(decoded);
+	return loaded;
+}
+
+void audioFree(Audio *audio)
+{
+	// nothing may still be mixing from the pool once it goes
+	Mix_HaltChannel(-1);
+	Mix_HaltMusic();
+	for (i32 i = 0; i < audio->numEffects; i++)
+		Mix_FreeChunk(audio->effects[i]);
+	memFree(audio->effects);
+	memFree(audio->pool);
+	if (audio->music)
+		Mix_FreeMusic(audio->music);
+	*audio = (Audio){0};
+}
+
+void audioPlayEffect(Audio *audio, i32 effect)
+{
+	if (effect >= 0 && effect < audio->numEffects)
+		Mix_PlayChannel(-1, audio->effects[effect], 0);
+}
+
+bool audioPlayMusic(Audio *audio, const char *name)
+{
+	const char *extensions[] = AUDIO_MUSIC_EXTENSIONS;
+	char path[256];
+	i64 size = audioFind(audio, name, extensions,
+	                     sizeof(extensions) / sizeof(extensions[0]),
+	                     path, sizeof(path));
+	if (size >= 0 && audio->music && strcmp(path, audio->musicPath) == 0)
+		return true;
+
+	// freeing the track halts it too
+	if (audio->music)
+	{
+		Mix_FreeMusic(audio->music);
+		audio->music = NULL;
+	}
+	if (size < 0)
+	{
+		fprintf(stderr, "No music file for %s in %s\n", name, AUDIO_DIR);
+		return false;
+	}
+
+	audio->music = Mix_LoadMUS(path);
+	if (!audio->music)
+	{
+		fprintf(stderr, "Failed to load %s: %s\n", path, Mix_GetError());
+		return false;
+	}
+	snprintf(audio->musicPath, sizeof(audio->musicPath), "%s", path);
+	audio->musicFileSize = size;
+	Mix_PlayMusic(audio->music, -1);
+	return true;
+}
+
+void audioReport(Audio *audio)
+{
+	fprintf(stderr, "Audio: %i effects in a %.1f KiB sample pool",
+	        audio->numEffects, audio->poolSize / 1024.0);
+	if (audio->music)
+	{
+		fprintf(stderr, ", streaming %s (%.1f KiB on disk)",
+		        audio->musicPath, audio->musicFileSize / 1024.0);
+	}
+	fprintf(stderr, "\n");
+}
@@ -0,0 +1,52 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+#include <SDL2/SDL_mixer.h>
+#include "common.h"
+
+#define AUDIO_DIR "assets/Audio/"
+
+// Sounds are named without their extension and looked up in AUDIO_DIR in
+// these orders. Effects are decoded up front anyway, so the .wav they were
+// made as wins; music is streamed, so a compressed file next to a .wav
+// does. Compressed files are skipped when the mixer cannot decode them.
+#define AUDIO_EFFECT_EXTENSIONS {".wav", ".opus", ".ogg"}
+#define AUDIO_MUSIC_EXTENSIONS {".opus", ".ogg", ".wav"}
+
+// Effects are decoded once, up front, into a single block of samples in
+// the mixer's format and played from there. Music is loaded when it is
+// first played and streamed from disk by the mixer, only the track
+// playing is ever open.
+typedef struct
+{
+	u8 *pool;
+	u32 poolSize;
+	Mix_Chunk **effects;
+	i32 numEffects;
+
+	Mix_Music *music;
+	char musicPath[256];
+	i64 musicFileSize;
+
+	// the MIX_INIT_ flags Mix_Init managed to load
+	i32 formats;
+} Audio;
+
+// Decodes the effects, effectNames[i] becomes effect i. False if one of
+// them could not be loaded.
+bool audioInit(Audio *audio, const char **effectNames, i32 numEffects);
+
+void audioFree(Audio *audio);
+
+void audioPlayEffect(Audio *audio, i32 effect);
+
+// Loops the track called name, loading it in place of the one playing.
+// The track already playing keeps going. One that cannot be found or
+// loaded stops the music, leaving the game silent rather than stopping it.
+bool audioPlayMusic(Audio *audio, const char *name);
+
+// what the audio holds in memory and streams, on stderr
+void audioReport(Audio *audio);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "bench.h"
+#include "mem.h"
+#include "board.h"
+
+typedef struct
+{
+	const char *name;
+	GenConfig config;
+	// configurations without restarts have no bound on a single board,
+	// so they are only run up to this size
+	i32 maxSize;
+} BenchConfig;
+
+static void benchRun(BenchConfig *bench, i32 size, i32 count, u32 seed)
+{
+	f64 total = 0.0;
+	f64 worst = 0.0;
+	u64 nodes = 0;
+	u64 backtracks = 0;
+	u64 probes = 0;
+	u64 hits = 0;
+	u64 restarts = 0;
+	u64 maxRestarts = 0;
+	i32 failed = 0;
+
+	srand(seed);
+	for (i32 i = 0; i < count; i++)
+	{
+		Board *board = boardCreate(size, size);
+		board->genConfig = bench->config;
+		board->quiet = true;
+		if (!boardGenerate(board))
+			failed += 1;
+
+		GenStats *stats = &board->genStats;
+		total += stats->seconds;
+		if (stats->seconds > worst)
+			worst = stats->seconds;
+		nodes += stats->nodes;
+		backtracks += stats->backtracks;
+		probes += stats->ttProbes;
+		hits += stats->ttHits;
+		restarts += stats->restarts;
+		if (stats->restarts > maxRestarts)
+			maxRestarts = stats->restarts;
+		boardFree(board);
+	}
+
+	fprintf(stderr, "%2ix%-2i %-11s mean %8.4fs  worst %8.4fs  "
+	        "nodes %10llu  backtracks %10llu  restarts %7.1f (max %4llu)  "
+	        "tt hits %5.1f%%  failed %i\n",
+	        size, size, bench->name, total / count, worst,
+	        (unsigned long long)nodes / count,
+	        (unsigned long long)backtracks / count,
+	        (f64)restarts / count, (unsigned long long)maxRestarts,
+	        probes ? 100.0 * hits / probes : 0.0, failed);
+}
+
+i32 benchMain(i32 argc, char *argv[])
+{
+	i32 minSize = argc > 0 ? atoi(argv[0]) : 9;
+	i32 maxSize = argc > 1 ? atoi(argv[1]) : 12;
+	i32 count   = argc > 2 ? atoi(argv[2]) : 20;
+	u32 seed    = argc > 3 ? (u32)atoi(argv[3]) : 1;
+
+	BenchConfig benches[] = {
+		{"baseline",    boardDefaultGenConfig(), 7},
+		{"tt",          boardDefaultGenConfig(), 7},
+		{"luby",        boardDefaultGenConfig(), 99},
+		{"geometric",   boardDefaultGenConfig(), 99},
+		{"warnsdorff",  boardDefaultGenConfig(), 99},
+		{"constrained", boardDefaultGenConfig(), 99},
+		{"both",        boardDefaultGenConfig(), 99}
+	};
+
+	// every row but the last turns off the ordering heuristics, so each
+	// one shows what its own feature adds
+	for (i32 b = 0; b < 6; b++)
+	{
+		benches[b].config.moveOrder = MOVEORDER_RANDOM;
+		benches[b].config.startOrder = STARTORDER_RANDOM;
+	}
+	benches[0].config.useTranspositionTable = false;
+	benches[0].config.restartPolicy = RESTART_NONE;
+	benches[1].config.restartPolicy = RESTART_NONE;
+	benches[2].config.restartPolicy = RESTART_LUBY;
+	benches[3].config.restartPolicy = RESTART_GEOMETRIC;
+	benches[4].config.moveOrder = MOVEORDER_WARNSDORFF;
+	benches[5].config.startOrder = STARTORDER_CONSTRAINED;
+
+	for (i32 size = minSize; size <= maxSize; size++)
+	{
+		for (u32 b = 0; b < sizeof(benches) / sizeof(benches[0]); b++)
+		{
+			if (size <= benches[b].maxSize)
+				benchRun(&benches[b], size, count, seed);
+		}
+	}
+	return 0;
+}
+
+// every board gets a fresh set of taken cells, a fill share of them, and
+// queries between random cells that are not
+void benchPaths(i32 size, f64 fill, i32 numQueries)
+{
+	const i32 numBoards = 16;
+	i32 *pairs = memAlloc(sizeof(i32) * 4 * numQueries);
+	i32 found = 0;
+	f64 seconds = 0.0;
+
+	for (i32 n = 0; n < numBoards; n++)
+	{
+		Board *board = boardCreate(size, size);
+		for (i32 r = 0; r < size; r++)
+		{
+			for (i32 c = 0; c < size; c++)
+			{
+				if (rand() < fill * RAND_MAX)
+					boardSetState(board, r, c, CELLSTATE_PIPE);
+			}
+		}
+		for (i32 i = 0; i < numQueries * 4; i++)
+			pairs[i] = rand() % size;
+
+		u64 startTime = SDL_GetPerformanceCounter();
+		for (i32 i = 0; i < numQueries; i++)
+		{
+			const i32 *q = &pairs[i * 4];
+			found += boardEmptyPathExists(board, q[0], q[1], q[2], q[3]);
+		}
+		seconds += (SDL_GetPerformanceCounter() - startTime)
+		           / (f64)SDL_GetPerformanceFrequency();
+		boardFree(board);
+	}
+
+	i32 total = numQueries * numBoards;
+	fprintf(stderr, "%2ix%-2i fill %3.0f%%  %11.0f queries/s  %6.3f us/query  "
+	        "joined %5.1f%%\n",
+	        size, size, fill * 100.0, total / seconds,
+	        seconds * 1e6 / total, 100.0 * found / total);
+	memFree(pairs);
+}
+
+i32 benchPathsMain(i32 argc, char *argv[])
+{
+	i32 numQueries = argc > 0 ? atoi(argv[0]) : 100000;
+	u32 seed       = argc > 1 ? (u32)atoi(argv[1]) : 1;
+	if (numQueries < 1)
+		numQueries = 1;
+
+	srand(seed);
+	i32 sizes[] = {10, 30};
+	f64 fills[] = {0.0, 0.3, 0.5};
+	for (u32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		for (u32 f = 0; f < sizeof(fills) / sizeof(fills[0]); f++)
+			benchPaths(sizes[s], fills[f], numQueries);
+	}
+	return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+// headless generator benchmark, run as: flow --bench [min] [max] [count] [seed]
+i32 benchMain(i32 argc, char *argv[]);
+
+// boardEmptyPathExists queries per second on 10x10 and 30x30 boards with
+// some of their cells taken, run as: flow --bench-paths [queries] [seed]
+i32 benchPathsMain(i32 argc, char *argv[]);
+
+#endif
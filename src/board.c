@@ -1,38 +1,171 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <limits.h>
 #include <time.h>
 #include <SDL2/SDL.h>
 
 #include "board.h"
+#include "mem.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "trace.h"
 
-bool placeStart(Board *board, i32 *pipes, i32 numPipes, i32 currentPipe,
-                i32 shortestPipeLength);
-bool placePipe(Board *board, i32 *pipes, i32 numPipes, i32 currentPipe,
-               i32 shortestPipeLength, i32 currentSize, i32 row, i32 col);
+#define DEFAULT_TRANSPOSITION_BITS 18
+#define DEFAULT_RESTART_BASE 2048
+#define DEFAULT_RESTART_FACTOR 1.5
+
+// seam merges on large boards stop before a pipe gets longer than this
+#define LARGE_MAX_PIPE_LENGTH (LARGE_REGION_SIZE * LARGE_REGION_SIZE)
+
+// owner values of the padded grid that are not a pipe index
+#define GEN_EMPTY -1
+#define GEN_WALL -2
+
+// nodes between two looks at whether a snapshot is due
+#define GEN_PUBLISH_MASK 1023
+
+// frames between two looks at the clock when genStep has a deadline
+#define GEN_CLOCK_MASK 63
+
+typedef struct GenFrame GenFrame;
+
+// search state of one genSearch call, or of one region of a large board
+typedef struct
+{
+	Board *board;
+	i32 *pipes;
+	i32 numPipes;
+	i32 shortestPipeLength;
+	u64 rng;
+
+	// node budget of the current attempt, see GenConfig.restartPolicy
+	u64 attemptNodes;
+	u64 budget;
+	bool aborted;
+
+	// Zobrist keys: zobristOccupied[i] for a cell taken by a finished pipe,
+	// zobristPipe[i] for a cell of the pipe being placed, zobristHead[i] for
+	// the head of that pipe and zobristIndex[p] for which pipe it is
+	u64 *zobristOccupied;
+	u64 *zobristPipe;
+	u64 *zobristHead;
+	u64 *zobristIndex;
+	u64 occupiedHash;
+	u64 pipeHash;
+
+	// changed on every restart, the pipe lengths differ between attempts
+	// so nothing learnt by an earlier one may be reused
+	u64 salt;
+
+	// keys of states known to fail, indexed by their low bits
+	u64 *deadStates;
+	u64 deadMask;
+
+	// empty cells in no particular order: emptyPos[i] is where cell i sits
+	// in emptyCells and removedFrom[i] where it was taken out from
+	i32 *emptyCells;
+	i32 *emptyPos;
+	i32 *removedFrom;
+	i32 numEmpty;
+
+	// Which pipe covers each cell, laid out like the padded board cells
+	// and GEN_WALL where the board has a wall. Kept apart from the cells
+	// because it is a quarter of their size.
+	i16 *owner;
+	i32 stride;
+	i32 delta[4];
+
+	// flood fill scratch, a cell is visited when it holds the current epoch
+	u32 *visited;
+	u32 epoch;
+	i32 *stack;
+
+	// the search stack, see GenFrame; result is what the last frame to
+	// return handed to its parent
+	GenFrame *frames;
+	i32 numFrames;
+	bool result;
+	u64 attempt;
+	bool placed;
+
+	// all scratch memory of one boardGenerate call
+	Arena arena;
+} Generator;
 
 Board* boardCreate(i32 width, i32 height)
 {
-	Board *board = malloc(sizeof(Board));
+	Board *board = memAlloc(sizeof(Board));
 	board->width = width;
 	board->height = height;
-	board->cells = malloc(sizeof(Cell) * width * height);
-	i32 size = width * height;
-	for (i32 i = 0; i < size; i++)
+	board->stride = width + 2;
+	board->numCells = board->stride * (height + 2);
+	board->delta[CELLCONNECTION_UP] = -board->stride;
+	board->delta[CELLCONNECTION_DOWN] = board->stride;
+	board->delta[CELLCONNECTION_LEFT] = -1;
+	board->delta[CELLCONNECTION_RIGHT] = 1;
+	board->cells = memAlloc(sizeof(Cell) * board->numCells);
+	for (i32 i = 0; i < board->numCells; i++)
 	{
-		board->cells[i].state = CELLSTATE_EMPTY;
-		board->cells[i].color = CELLCOLOR_RED;
+		i32 row = i / board->stride;
+		i32 col = i % board->stride;
+		bool wall = row == 0 || row == height + 1
+		            || col == 0 || col == width + 1;
+		board->cells[i].state = wall ? CELLSTATE_WALL : CELLSTATE_EMPTY;
+		board->cells[i].color = 0;
 		board->cells[i].connection = CELLCONNECTION_NONE;
 	}
 	board->genState = GENSTATE_IDLE;
+	board->parent = NULL;
+	board->numColors = 0;
+	board->seed = 0;
+	board->genConfig = boardDefaultGenConfig();
+	board->genStats = (GenStats){0};
+	board->keepSolution = false;
+	board->pipeLengths = NULL;
+	board->quiet = false;
+	board->snapshots = NULL;
+	board->pathVisited = NULL;
+	board->pathEpoch = 0;
+	board->pathQueue = NULL;
 	return board;
 }
 
+GenConfig boardDefaultGenConfig(void)
+{
+	return (GenConfig){
+		.useTranspositionTable = true,
+		.transpositionBits = DEFAULT_TRANSPOSITION_BITS,
+		.restartPolicy = RESTART_LUBY,
+		.restartBase = DEFAULT_RESTART_BASE,
+		.restartFactor = DEFAULT_RESTART_FACTOR,
+		.moveOrder = MOVEORDER_WARNSDORFF,
+		.startOrder = STARTORDER_CONSTRAINED
+	};
+}
+
 void boardFree(Board *board)
 {
-	free(board->cells);
-	free(board);
+	snapshotsFree(board->snapshots);
+	memFree(board->pipeLengths);
+	memFree(board->pathVisited);
+	memFree(board->pathQueue);
+	memFree(board->cells);
+	memFree(board);
+}
+
+void boardEnableSnapshots(Board *board)
+{
+	if (!board->snapshots)
+		board->snapshots = snapshotsCreate(board->cells, board->numCells);
+}
+
+const Cell* boardSnapshot(Board *board)
+{
+	if (!board->snapshots || board->genState == GENSTATE_IDLE)
+		return board->cells;
+	return snapshotsLatest(board->snapshots);
 }
 
 void boardSetColor(Board *board, i32 r, i32 c, CellColor color)
@@ -47,7 +180,7 @@ void boardSetState(Board *board, i32 r, i32 c, CellState state)
 
 Cell* boardGet(Board *board, i32 r, i32 c)
 {
-	return &board->cells[r * board->width + c];
+	return &board->cells[(r + 1) * board->stride + c + 1];
 }
 
 Cell* boardGetI(Board *board, i32 index)
@@ -55,6 +188,11 @@ Cell* boardGetI(Board *board, i32 index)
 	return &board->cells[index];
 }
 
+i32 boardIndex(Board *board, i32 r, i32 c)
+{
+	return (r + 1) * board->stride + c + 1;
+}
+
 bool boardBoundsCheck(Board *board, i32 r, i32 c)
 {
 	return r >= 0 && r < board->height && c >= 0 && c < board->width;
@@ -80,363 +218,1721 @@ void boardPrint(Board *board)
 	}
 }
 
-void boardDfsFillState(Board *board, i32 row, i32 col, CellState oldState,
-                       CellState newState)
+// Both searches mark the cells they reach, the one from the first cell
+// with pathEpoch and the one from the second with pathEpoch + 1, so a new
+// query only has to move the epoch on.
+bool boardEmptyPathExists(Board *board, i32 r1, i32 c1, i32 r2, i32 c2)
 {
-	if (!boardBoundsCheck(board, row, col))
-		return;
+	if (!boardBoundsCheck(board, r1, c1) || !boardBoundsCheck(board, r2, c2))
+		return false;
+
+	i32 a = boardIndex(board, r1, c1);
+	i32 b = boardIndex(board, r2, c2);
+	if (   board->cells[a].state == CELLSTATE_WALL
+	    || board->cells[b].state == CELLSTATE_WALL)
+	{
+		return false;
+	}
+	if (a == b)
+		return true;
+
+	if (!board->pathVisited)
+	{
+		board->pathVisited = memCalloc(board->numCells, sizeof(u32));
+		board->pathQueue = memAlloc(sizeof(i32) * board->numCells * 2);
+		board->pathEpoch = 0;
+	}
+	board->pathEpoch += 2;
+	if (board->pathEpoch < 2)
+	{
+		memset(board->pathVisited, 0, sizeof(u32) * board->numCells);
+		board->pathEpoch = 2;
+	}
 
-	i32 bi = row * board->width + col;
-	if (board->cells[bi].state == oldState)
+	u32 *visited = board->pathVisited;
+	const Cell *cells = board->cells;
+	u32 mark[2] = {board->pathEpoch, board->pathEpoch + 1};
+	i32 *queue[2] = {board->pathQueue, board->pathQueue + board->numCells};
+	i32 head[2] = {0, 0};
+	i32 tail[2] = {1, 1};
+	queue[0][0] = a;
+	queue[1][0] = b;
+	visited[a] = mark[0];
+	visited[b] = mark[1];
+
+	// a level at a time from whichever side has the smaller frontier, the
+	// two searches meet after reaching about half the cells one would
+	while (head[0] < tail[0] && head[1] < tail[1])
 	{
-		board->cells[bi].state = newState;
-		boardDfsFillState(board, row - 1, col, oldState, newState);
-		boardDfsFillState(board, row + 1, col, oldState, newState);
-		boardDfsFillState(board, row, col - 1, oldState, newState);
-		boardDfsFillState(board, row, col + 1, oldState, newState);
+		i32 side = tail[0] - head[0] <= tail[1] - head[1] ? 0 : 1;
+		u32 own = mark[side];
+		u32 other = mark[side ^ 1];
+		i32 *sideQueue = queue[side];
+		i32 levelEnd = tail[side];
+		i32 end = tail[side];
+
+		for (i32 k = head[side]; k < levelEnd; k++)
+		{
+			i32 i = sideQueue[k];
+			for (i32 d = 0; d < 4; d++)
+			{
+				i32 q = i + board->delta[d];
+				if (visited[q] == other)
+					return true;
+				if (cells[q].state == CELLSTATE_EMPTY && visited[q] != own)
+				{
+					visited[q] = own;
+					sideQueue[end++] = q;
+				}
+			}
+		}
+		head[side] = levelEnd;
+		tail[side] = end;
 	}
+	return false;
+}
+
+bool boardIsPipe(Cell *cell)
+{
+	return cell->state == CELLSTATE_PIPE_START
+	    || cell->state == CELLSTATE_PIPE_END
+	    || cell->state == CELLSTATE_PIPE;
 }
 
-bool boardIsEmptyConnected(Board *board, i32 row, i32 col)
+i32 boardAdjacentWithColorI(Board *board, i32 index, CellColor color)
 {
-	CellState prevState = boardGet(board, row, col)->state;
+	i32 count = 0;
+	for (i32 d = 0; d < 4; d += 1)
+	{
+		Cell *adj = &board->cells[index + board->delta[d]];
+		if (boardIsPipe(adj) && adj->color == color)
+			count += 1;
+	}
+	return count;
+}
 
-	board->cells[row * board->width + col].state = CELLSTATE_PIPE_START;
+i32 boardAdjacentWithColor(Board *board, i32 row, i32 col, CellColor color)
+{
+	return boardAdjacentWithColorI(board, boardIndex(board, row, col), color);
+}
 
-	i32 emptyIndex = 0;
-	bool emptyFound = false;
+const char* boardValidate(Board *board)
+{
+	if (board->numColors < 1)
+		return "no pipes";
 
-	i32 size = board->width * board->height;
-	for (i32 i = 0; i < size; i++)
+	i32 covered = 0;
+	for (i32 r = 0; r < board->height; r++)
 	{
-		if (board->cells[i].state == CELLSTATE_EMPTY)
+		for (i32 c = 0; c < board->width; c++)
 		{
-			emptyIndex = i;
-			emptyFound = true;
-			break;
+			Cell *cell = boardGet(board, r, c);
+			if (cell->state == CELLSTATE_WALL)
+				continue;
+			if (!boardIsPipe(cell))
+				return "a cell is not covered";
+			if (cell->color >= board->numColors)
+				return "a cell has a color past numColors";
+			covered += 1;
 		}
 	}
 
-	if (!emptyFound)
+	// every pipe is followed from its start, found in reading order
+	i32 traced = 0;
+	for (i32 i = 0; i < board->numCells; i++)
 	{
-		boardGet(board, row, col)->state = prevState;
-		return true;
+		Cell *cell = &board->cells[i];
+		if (cell->state != CELLSTATE_PIPE_START)
+			continue;
+
+		CellColor color = cell->color;
+		i32 length = 1;
+		i32 index = i;
+		while (board->cells[index].state != CELLSTATE_PIPE_END)
+		{
+			// one neighbour of its own color at the start, two on the way
+			Cell *at = &board->cells[index];
+			i32 degree = length > 1 ? 2 : 1;
+			if (boardAdjacentWithColorI(board, index, color) != degree)
+				return "a pipe touches itself";
+			if (at->connection >= CELLCONNECTION_NONE)
+				return "a pipe stops before its end";
+
+			index += board->delta[at->connection];
+			Cell *next = &board->cells[index];
+			length += 1;
+			if (   next->color != color
+			    || (   next->state != CELLSTATE_PIPE
+			        && next->state != CELLSTATE_PIPE_END))
+			{
+				return "a pipe runs off its color";
+			}
+			if (length > covered)
+				return "a pipe runs in a loop";
+		}
+		if (boardAdjacentWithColorI(board, index, color) != 1)
+			return "a pipe touches itself";
+
+		if (length < 3)
+			return "a pipe is shorter than 3 cells";
+		if (board->pipeLengths && length != board->pipeLengths[color])
+			return "a pipe is not as long as pipeLengths says";
+		traced += length;
 	}
 
-	i32 emptyRow = emptyIndex / board->width;
-	i32 emptyCol = emptyIndex % board->width;
+	// starts of every color, then ends
+	i32 *seen = memCalloc(board->numColors * 2, sizeof(i32));
+	const char *result = NULL;
+	for (i32 i = 0; i < board->numCells; i++)
+	{
+		Cell *cell = &board->cells[i];
+		if (cell->state == CELLSTATE_PIPE_START)
+			seen[cell->color] += 1;
+		else if (cell->state == CELLSTATE_PIPE_END)
+			seen[board->numColors + cell->color] += 1;
+	}
+	for (i32 color = 0; color < board->numColors && !result; color++)
+	{
+		if (seen[color] != 1 || seen[board->numColors + color] != 1)
+			result = "a color does not have exactly two endpoints";
+	}
+	memFree(seen);
 
-	boardDfsFillState(board, emptyRow, emptyCol,
-	                  CELLSTATE_EMPTY, CELLSTATE_EMPTY_MARKED);
+	// with every color started once and ended once, the pipes traced
+	// above are all of them and nothing else is left
+	if (!result && traced != covered)
+		result = "a cell is on no pipe";
+	return result;
+}
 
-	bool allEmptyVisited = true;
-	for (i32 i = 0; i < size; i++)
-	{
-		if (board->cells[i].state == CELLSTATE_EMPTY)
-			allEmptyVisited = false;
+u64 splitMix64(u64 *state)
+{
+	u64 z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+i32 genRandom(Generator *gen, i32 n)
+{
+	return splitMix64(&gen->rng) % n;
+}
+
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ... for i = 1, 2, 3, ...
+u64 lubySequence(u64 i)
+{
+	u64 k = 1;
+	while ((1ull << k) - 1 < i)
+		k += 1;
+
+	if ((1ull << k) - 1 == i)
+		return 1ull << (k - 1);
+
+	return lubySequence(i - (1ull << (k - 1)) + 1);
+}
 
-		else if (board->cells[i].state == CELLSTATE_EMPTY_MARKED)
-			board->cells[i].state = CELLSTATE_EMPTY;
+u64 genAttemptBudget(GenConfig *config, u64 attempt)
+{
+	switch (config->restartPolicy)
+	{
+		case RESTART_LUBY:
+			return config->restartBase * lubySequence(attempt);
+		case RESTART_GEOMETRIC:
+		{
+			f64 budget = config->restartBase;
+			for (u64 i = 1; i < attempt && budget < (f64)UINT64_MAX / 2; i++)
+				budget *= config->restartFactor;
+			return (u64)budget;
+		}
+		default:
+		case RESTART_NONE:
+			return UINT64_MAX;
 	}
+}
+
+// hands the cells out as a snapshot, if the board publishes them
+void genPublish(Board *board, bool force)
+{
+	if (board->snapshots)
+		snapshotsPublish(board->snapshots, board->cells, force);
+}
 
-	board->cells[row * board->width + col].state = prevState;
+// counts a node against the budget, false once the attempt should stop
+bool genSpendNode(Generator *gen)
+{
+	gen->board->genStats.nodes += 1;
+	gen->attemptNodes += 1;
+
+	// reading the clock on every node would cost more than the node
+	if ((gen->attemptNodes & GEN_PUBLISH_MASK) == 0)
+		genPublish(gen->board, false);
 
-	return allEmptyVisited;
+	if (gen->attemptNodes > gen->budget)
+		gen->aborted = true;
+	return !gen->aborted;
 }
 
-i32 boardAdjacentWithColor(Board *board, i32 row, i32 col, CellColor color)
+void genSwapEmpty(Generator *gen, i32 a, i32 b)
 {
-	Vec2i dirs[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
-	i32 count = 0;
+	i32 cellA = gen->emptyCells[a];
+	i32 cellB = gen->emptyCells[b];
+	gen->emptyCells[a] = cellB;
+	gen->emptyCells[b] = cellA;
+	gen->emptyPos[cellB] = a;
+	gen->emptyPos[cellA] = b;
+}
 
-	for (i32 d = 0; d < 4; d += 1)
+// the search numbers cells row by row without the wall ring
+i32 genPadded(Generator *gen, i32 index)
+{
+	i32 width = gen->board->width;
+	return (index / width + 1) * gen->stride + index % width + 1;
+}
+
+u32 genNextEpoch(Generator *gen)
+{
+	gen->epoch += 1;
+	if (gen->epoch == 0)
 	{
-		i32 adjRow = row + dirs[d].y;
-		i32 adjCol = col + dirs[d].x;
+		memset(gen->visited, 0, sizeof(u32) * gen->board->numCells);
+		gen->epoch = 1;
+	}
+	return gen->epoch;
+}
 
-		if (   adjRow >= 0 && adjRow < board->height
-			&& adjCol >= 0 && adjCol < board->width
-			&& boardGet(board, adjRow, adjCol)->state != CELLSTATE_EMPTY
-			&& boardGet(board, adjRow, adjCol)->state != CELLSTATE_EMPTY_MARKED
-			&& boardGet(board, adjRow, adjCol)->color == color)
-		{
-			count += 1;
-		}
+#define GEN_VISIT(q)                                       \
+	if (owner[q] == GEN_EMPTY && visited[q] != epoch)      \
+	{                                                      \
+		visited[q] = epoch;                                \
+		stack[top++] = q;                                  \
+		if (--remaining == 0)                              \
+			return true;                                   \
 	}
 
-	return count;
+// The checks the start and pipe frames run on every candidate cell, given
+// as an index p into the padded grid.
+i32 genAdjacentOwned(Generator *gen, i32 p, i32 pipe)
+{
+	const i16 *owner = gen->owner;
+	i32 stride = gen->stride;
+	return (owner[p - stride] == pipe) + (owner[p + stride] == pipe)
+	     + (owner[p - 1] == pipe) + (owner[p + 1] == pipe);
 }
 
+i32 genEmptyNeighbours(Generator *gen, i32 p)
+{
+	const i16 *owner = gen->owner;
+	i32 stride = gen->stride;
+	return (owner[p - stride] == GEN_EMPTY) + (owner[p + stride] == GEN_EMPTY)
+	     + (owner[p - 1] == GEN_EMPTY) + (owner[p + 1] == GEN_EMPTY);
+}
 
-bool placePipe(Board *board, i32 *pipes, i32 numPipes, i32 currentPipe,
-               i32 shortestPipeLength, i32 currentSize, i32 row, i32 col)
+// Whether the empty cells stay in one piece once p is taken. Starts from
+// any other member of the empty set and only has to count what it reaches.
+bool genEmptyConnected(Generator *gen, i32 p)
 {
-	// check first if we want to stop generating
-	if (board->genState == GENSTATE_STOPREQUESTED)
+	i32 remaining = gen->numEmpty - 1;
+	if (remaining <= 0)
+		return true;
+
+	const i16 *owner = gen->owner;
+	i32 stride = gen->stride;
+	u32 *visited = gen->visited;
+	i32 *stack = gen->stack;
+	u32 epoch = genNextEpoch(gen);
+	visited[p] = epoch;
+
+	i32 start = genPadded(gen, gen->emptyCells[0]);
+	if (start == p)
+		start = genPadded(gen, gen->emptyCells[1]);
+	visited[start] = epoch;
+	stack[0] = start;
+	i32 top = 1;
+	if (--remaining == 0)
+		return true;
+
+	while (top > 0)
 	{
-		board->genState = GENSTATE_STOPPING;
+		i32 i = stack[--top];
+		GEN_VISIT(i - stride)
+		GEN_VISIT(i + stride)
+		GEN_VISIT(i - 1)
+		GEN_VISIT(i + 1)
+	}
+	return false;
+}
+
+// Every cell change in the search goes through these two so the state
+// hash, the padded owner grid and the empty set stay in step with the
+// board. Cells are always cleared in the reverse order they were set, so
+// swapping a cleared cell back to where it was taken from restores the
+// exact order of the set.
+void genSetCell(Generator *gen, i32 index, i32 pipe, CellState state)
+{
+	i32 p = genPadded(gen, index);
+	Cell *cell = boardGetI(gen->board, p);
+	cell->state = state;
+	cell->color = pipe;
+	gen->owner[p] = pipe;
+	gen->occupiedHash ^= gen->zobristOccupied[index];
+	gen->pipeHash ^= gen->zobristPipe[index];
+
+	gen->removedFrom[index] = gen->emptyPos[index];
+	genSwapEmpty(gen, gen->emptyPos[index], gen->numEmpty - 1);
+	gen->numEmpty -= 1;
+}
+
+void genClearCell(Generator *gen, i32 index)
+{
+	i32 p = genPadded(gen, index);
+	Cell *cell = boardGetI(gen->board, p);
+	cell->state = CELLSTATE_EMPTY;
+	cell->color = 0;
+	gen->owner[p] = GEN_EMPTY;
+	gen->occupiedHash ^= gen->zobristOccupied[index];
+	gen->pipeHash ^= gen->zobristPipe[index];
+
+	gen->numEmpty += 1;
+	genSwapEmpty(gen, gen->numEmpty - 1, gen->removedFrom[index]);
+}
+
+// Colours of finished pipes never matter again, only which cells they
+// cover, so two routes that pack the same cells reach the same key.
+u64 genPipeKey(Generator *gen, i32 currentPipe, i32 row, i32 col)
+{
+	return gen->occupiedHash ^ gen->pipeHash ^ gen->zobristIndex[currentPipe]
+	       ^ gen->zobristHead[row * gen->board->width + col] ^ gen->salt;
+}
+
+u64 genStartKey(Generator *gen, i32 currentPipe)
+{
+	return gen->occupiedHash ^ ~gen->zobristIndex[currentPipe] ^ gen->salt;
+}
+
+bool genIsDead(Generator *gen, u64 key)
+{
+	if (!gen->deadStates)
+		return false;
+
+	gen->board->genStats.ttProbes += 1;
+	if (gen->deadStates[key & gen->deadMask] == key)
+	{
+		gen->board->genStats.ttHits += 1;
 		return true;
 	}
+	return false;
+}
 
-	while (board->genState == GENSTATE_PAUSE)
+void genMarkDead(Generator *gen, u64 key)
+{
+	// a stop request or a spent budget unwinds the search without
+	// exhausting it
+	if (   !gen->deadStates
+	    || gen->aborted
+	    || gen->board->genState == GENSTATE_STOPPING)
 	{
-		SDL_Delay(100);
+		return;
 	}
 
-	bool rejected[4] = {true, true, true, true};
-	i32 numRejected = 4;
-	Vec2i dirs[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+	gen->deadStates[key & gen->deadMask] = key;
+	gen->board->genStats.ttStores += 1;
+}
+
+// the open direction with the lowest score, uniformly among ties
+i32 genPickDirection(Generator *gen, bool *rejected, i32 *score)
+{
+	i32 best = INT_MAX;
+	i32 ties = 0;
+	i32 direction = 0;
 
 	for (i32 d = 0; d < 4; d += 1)
 	{
-		i32 adjRow = row + dirs[d].y;
-		i32 adjCol = col + dirs[d].x;
+		if (rejected[d])
+			continue;
 
-		if (   adjRow >= 0 && adjRow < board->height
-			&& adjCol >= 0 && adjCol < board->width
-			&& boardGet(board, adjRow, adjCol)->state == CELLSTATE_EMPTY
-			&& boardAdjacentWithColor(board, adjRow, adjCol, currentPipe) < 2
-			&& boardIsEmptyConnected(board, adjRow, adjCol))
+		if (score[d] < best)
 		{
-			rejected[d] = false;
-			numRejected -= 1;
+			best = score[d];
+			ties = 1;
+			direction = d;
+		}
+		else if (score[d] == best)
+		{
+			ties += 1;
+			if (genRandom(gen, ties) == 0)
+				direction = d;
 		}
 	}
+	return direction;
+}
 
-	if (numRejected == 4)
-		return false;
+// Position in emptyCells of the next start to try. Constrained order wants
+// the cells that are hardest to reach later: few empty neighbours first
+// (corners, dead ends, corridors), then cells on the border.
+i32 genPickStart(Generator *gen, i32 numRejected)
+{
+	if (gen->board->genConfig.startOrder == STARTORDER_RANDOM)
+		return numRejected + genRandom(gen, gen->numEmpty - numRejected);
+
+	Board *board = gen->board;
+	i32 best = INT_MAX;
+	i32 ties = 0;
+	i32 pick = numRejected;
 
-	currentSize += 1;
-	while (numRejected < 4)
+	for (i32 i = numRejected; i < gen->numEmpty; i++)
 	{
-		i32 direction = 0;
+		i32 row = gen->emptyCells[i] / board->width;
+		i32 col = gen->emptyCells[i] % board->width;
+		bool border = row == 0 || row == board->height - 1
+		              || col == 0 || col == board->width - 1;
+		i32 p = (row + 1) * gen->stride + col + 1;
+		i32 score = genEmptyNeighbours(gen, p) * 2 + !border;
+
+		if (score < best)
 		{
-			i32 dir = rand() % (4 - numRejected);
-			i32 dirIndex = 0;
-			for (i32 d = 0; d < 4; d += 1)
-			{
-				if (!rejected[d])
-				{
-					if (dirIndex == dir)
-					{
-						direction = d;
-						break;
-					}
-					else
-					{
-						dirIndex += 1;
-					}
-				}
-			}
+			best = score;
+			ties = 1;
+			pick = i;
+		}
+		else if (score == best)
+		{
+			ties += 1;
+			if (genRandom(gen, ties) == 0)
+				pick = i;
 		}
+	}
+	return pick;
+}
+
+typedef enum
+{
+	GENFRAME_START,
+	GENFRAME_PIPE
+} GenFrameKind;
+
+// what running a frame asks of genStep: run the child it has just
+// pushed, hand gen->result back to its parent, or give up the thread
+// while the board is paused
+typedef enum
+{
+	GENSTEP_CALL,
+	GENSTEP_RETURN,
+	GENSTEP_YIELD
+} GenStepResult;
+
+// One level of the search, placing a start or extending a pipe by one
+// cell. The levels live on an explicit stack rather than the C stack, so
+// the search can be left after any node and picked up again later.
+struct GenFrame
+{
+	GenFrameKind kind;
+	bool entered;
+	i32 pipe;
+	u64 key;
+	i32 numRejected;
+
+	// start frames: the rejected starts, see genStartNext
+	size_t mark;
+	i32 *swaps;
+	i32 pick;
+	i32 startIndex;
+
+	// pipe frames: the head of the pipe and its length so far
+	i32 size;
+	i32 row;
+	i32 col;
+	bool rejected[4];
+	i32 score[4];
+	i32 direction;
+	i32 adjIndex;
+	bool endsPipe;
+	u64 pipeHash;
+};
+
+GenFrame* genPushFrame(Generator *gen, GenFrameKind kind, i32 pipe)
+{
+	GenFrame *frame = &gen->frames[gen->numFrames++];
+	frame->kind = kind;
+	frame->entered = false;
+	frame->pipe = pipe;
+	return frame;
+}
 
-		i32 adjRow = row + dirs[direction].y;
-		i32 adjCol = col + dirs[direction].x;
+// the parent has already set the head cell of a pipe frame
+void genPushPipe(Generator *gen, i32 pipe, i32 size, i32 index)
+{
+	GenFrame *frame = genPushFrame(gen, GENFRAME_PIPE, pipe);
+	frame->size = size;
+	frame->row = index / gen->board->width;
+	frame->col = index % gen->board->width;
+}
 
-		Cell *adjCell = boardGet(board, adjRow, adjCol);
-		bool placed = false;
+GenStepResult genReturn(Generator *gen, bool placed)
+{
+	gen->result = placed;
+	return GENSTEP_RETURN;
+}
 
-		adjCell->color = currentPipe;
-		boardGet(board, row, col)->connection = direction;
+GenStepResult genPipeNext(Generator *gen, GenFrame *frame)
+{
+	Board *board = gen->board;
 
-		if (currentSize == pipes[currentPipe])
-		{
-			adjCell->state = CELLSTATE_PIPE_END;
-			placed = (currentPipe == numPipes - 1)
-			         || placeStart(board, pipes, numPipes, currentPipe + 1,
-					               shortestPipeLength);
-		}
-		else
+	if (frame->numRejected == 4)
+	{
+		genMarkDead(gen, frame->key);
+		return genReturn(gen, false);
+	}
+
+	Vec2i dirs[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+	i32 direction = genPickDirection(gen, frame->rejected, frame->score);
+	i32 adjRow = frame->row + dirs[direction].y;
+	i32 adjCol = frame->col + dirs[direction].x;
+	frame->direction = direction;
+	frame->adjIndex = adjRow * board->width + adjCol;
+
+	boardGet(board, frame->row, frame->col)->connection = direction;
+
+	frame->endsPipe = frame->size == gen->pipes[frame->pipe];
+	if (!frame->endsPipe)
+	{
+		genSetCell(gen, frame->adjIndex, frame->pipe, CELLSTATE_PIPE);
+		genPushPipe(gen, frame->pipe, frame->size, frame->adjIndex);
+		return GENSTEP_CALL;
+	}
+
+	genSetCell(gen, frame->adjIndex, frame->pipe, CELLSTATE_PIPE_END);
+	if (frame->pipe == gen->numPipes - 1)
+		return genReturn(gen, true);
+
+	// the next pipe starts with none of its own cells
+	frame->pipeHash = gen->pipeHash;
+	gen->pipeHash = 0;
+	genPushFrame(gen, GENFRAME_START, frame->pipe + 1);
+	return GENSTEP_CALL;
+}
+
+// Takes a stop request or pause made on the large board over to the
+// region's board being generated, and the end of the pause.
+static void genFollowParent(Board *board)
+{
+	GenState state = board->parent->genState;
+	if (state == GENSTATE_STOPREQUESTED || state == GENSTATE_STOPPING)
+	{
+		if (board->genState != GENSTATE_STOPPING)
+			board->genState = GENSTATE_STOPREQUESTED;
+	}
+	else if (state == GENSTATE_PAUSE)
+	{
+		board->genState = GENSTATE_PAUSE;
+	}
+	else if (board->genState == GENSTATE_PAUSE)
+	{
+		board->genState = GENSTATE_GENERATING;
+	}
+}
+
+GenStepResult genPipeEnter(Generator *gen, GenFrame *frame)
+{
+	Board *board = gen->board;
+	if (board->parent)
+		genFollowParent(board);
+
+	// check first if we want to stop generating
+	if (board->genState == GENSTATE_STOPREQUESTED)
+	{
+		board->genState = GENSTATE_STOPPING;
+		return genReturn(gen, true);
+	}
+
+	if (board->genState == GENSTATE_PAUSE)
+		return GENSTEP_YIELD;
+
+	if (!genSpendNode(gen))
+		return genReturn(gen, false);
+
+	frame->key = genPipeKey(gen, frame->pipe, frame->row, frame->col);
+	if (genIsDead(gen, frame->key))
+		return genReturn(gen, false);
+
+	bool warnsdorff = board->genConfig.moveOrder == MOVEORDER_WARNSDORFF;
+	i32 p = (frame->row + 1) * gen->stride + frame->col + 1;
+	frame->numRejected = 4;
+
+	// the wall ring stands in for the bounds checks
+	for (i32 d = 0; d < 4; d += 1)
+	{
+		i32 q = p + gen->delta[d];
+
+		frame->rejected[d] = true;
+		frame->score[d] = 0;
+		if (   gen->owner[q] == GEN_EMPTY
+			&& genAdjacentOwned(gen, q, frame->pipe) < 2
+			&& genEmptyConnected(gen, q))
 		{
-			adjCell->state = CELLSTATE_PIPE;
-			placed = placePipe(board, pipes, numPipes, currentPipe,
-					           shortestPipeLength, currentSize, adjRow, adjCol);
+			frame->rejected[d] = false;
+			frame->numRejected -= 1;
+
+			// the subtree restores the board before we pick again, so the
+			// scores hold for every pick of this frame
+			if (warnsdorff)
+				frame->score[d] = genEmptyNeighbours(gen, q);
 		}
+	}
+
+	if (frame->numRejected == 4)
+	{
+		genMarkDead(gen, frame->key);
+		return genReturn(gen, false);
+	}
+
+	frame->size += 1;
+	return genPipeNext(gen, frame);
+}
+
+GenStepResult genPipeResume(Generator *gen, GenFrame *frame)
+{
+	Board *board = gen->board;
+
+	if (frame->endsPipe)
+		gen->pipeHash = frame->pipeHash;
+
+	if (gen->result)
+		return GENSTEP_RETURN;
+
+	frame->rejected[frame->direction] = true;
+	frame->numRejected += 1;
+	genClearCell(gen, frame->adjIndex);
+	boardGet(board, frame->row, frame->col)->connection = CELLCONNECTION_NONE;
+	board->genStats.backtracks += 1;
 
-		if (!placed)
+	if (gen->aborted)
+		return genReturn(gen, false);
+	return genPipeNext(gen, frame);
+}
+
+// Hands the empty set back in the order it came in and fails.
+GenStepResult genStartFail(Generator *gen, GenFrame *frame)
+{
+	for (i32 i = frame->numRejected - 1; i >= 0; i--)
+	{
+		genSwapEmpty(gen, i, frame->swaps[i]);
+	}
+	genMarkDead(gen, frame->key);
+	arenaReset(&gen->arena, frame->mark);
+	return genReturn(gen, false);
+}
+
+void genStartReject(Generator *gen, GenFrame *frame)
+{
+	genSwapEmpty(gen, frame->numRejected, frame->pick);
+	frame->swaps[frame->numRejected] = frame->pick;
+	frame->numRejected += 1;
+}
+
+GenStepResult genStartNext(Generator *gen, GenFrame *frame)
+{
+	while (frame->numRejected < gen->numEmpty)
+	{
+		frame->pick = genPickStart(gen, frame->numRejected);
+		frame->startIndex = gen->emptyCells[frame->pick];
+
+		i32 p = genPadded(gen, frame->startIndex);
+		if (genEmptyConnected(gen, p))
 		{
-			rejected[direction] = true;
-			numRejected += 1;
-			adjCell->state = CELLSTATE_EMPTY;
-			adjCell->color = 0;
-			boardGet(board, row, col)->connection = CELLCONNECTION_NONE;
+			genSetCell(gen, frame->startIndex, frame->pipe,
+			           CELLSTATE_PIPE_START);
+			genPushPipe(gen, frame->pipe, 1, frame->startIndex);
+			return GENSTEP_CALL;
 		}
-		else
-			return true;
+		genStartReject(gen, frame);
 	}
-	return false;
+	return genStartFail(gen, frame);
+}
+
+GenStepResult genStartEnter(Generator *gen, GenFrame *frame)
+{
+	if (!genSpendNode(gen))
+		return genReturn(gen, false);
+
+	frame->key = genStartKey(gen, frame->pipe);
+	if (genIsDead(gen, frame->key))
+		return genReturn(gen, false);
+
+	// Candidates are emptyCells[numRejected..numEmpty). A rejected start
+	// is swapped down into the prefix and the swap is logged, so the set
+	// can be handed back to the parent in the order it came in.
+	frame->mark = arenaMark(&gen->arena);
+	frame->swaps = arenaAlloc(&gen->arena, sizeof(i32) * gen->numEmpty);
+	frame->numRejected = 0;
+	return genStartNext(gen, frame);
+}
+
+GenStepResult genStartResume(Generator *gen, GenFrame *frame)
+{
+	if (gen->result)
+	{
+		arenaReset(&gen->arena, frame->mark);
+		return GENSTEP_RETURN;
+	}
+
+	genClearCell(gen, frame->startIndex);
+	gen->board->genStats.backtracks += 1;
+	if (gen->aborted)
+		return genStartFail(gen, frame);
+
+	genStartReject(gen, frame);
+	return genStartNext(gen, frame);
+}
+
+// a frame is entered once and resumed every time a child returns to it
+GenStepResult genRunFrame(Generator *gen, GenFrame *frame)
+{
+	if (frame->entered)
+	{
+		return frame->kind == GENFRAME_START ? genStartResume(gen, frame)
+		                                     : genPipeResume(gen, frame);
+	}
+
+	GenStepResult step = frame->kind == GENFRAME_START
+	                     ? genStartEnter(gen, frame)
+	                     : genPipeEnter(gen, frame);
+
+	// a paused frame is entered again once the pause is over
+	if (step != GENSTEP_YIELD)
+		frame->entered = true;
+	return step;
+}
+
+// random lengths of at least 3 that add up to the board size
+void genAssignPipes(Generator *gen)
+{
+	i32 size = gen->board->width * gen->board->height;
+
+	for (i32 i = 0; i < gen->numPipes; i++)
+	{
+		gen->pipes[i] = 3;
+	}
+
+	i32 totalPipeLength = gen->numPipes * 3;
+
+	while (totalPipeLength < size)
+	{
+		i32 index = genRandom(gen, gen->numPipes);
+		gen->pipes[index] += 1;
+		totalPipeLength += 1;
+	}
+
+	gen->shortestPipeLength = INT_MAX;
+	for (i32 i = 0; i < gen->numPipes; i++)
+	{
+		if (gen->pipes[i] < gen->shortestPipeLength)
+			gen->shortestPipeLength = gen->pipes[i];
+	}
+}
+
+void genBeginAttempt(Generator *gen, u64 attempt)
+{
+	i32 size = gen->board->width * gen->board->height;
+	for (i32 i = 0; i < size; i++)
+	{
+		gen->emptyCells[i] = i;
+		gen->emptyPos[i] = i;
+	}
+	gen->numEmpty = size;
+
+	genAssignPipes(gen);
+	gen->salt = splitMix64(&gen->rng);
+	gen->attempt = attempt;
+	gen->budget = genAttemptBudget(&gen->board->genConfig, attempt);
+	gen->attemptNodes = 0;
+	gen->aborted = false;
+
+	gen->numFrames = 0;
+	genPushFrame(gen, GENFRAME_START, 0);
 }
 
-bool placeStart(Board *board, i32 *pipes, i32 numPipes, i32 currentPipe,
-                i32 shortestPipeLength)
+// Sets up the search on the whole board and its first attempt. False
+// when the board has no room for its pipes or the memory is not there.
+bool genInit(Generator *gen, Board *board)
 {
-	i32 rejectedSize = board->width * board->height;
+	i32 numPipes = board->width;
+	i32 size = board->width * board->height;
+	if (numPipes * 3 > size)
+		return false;
+
+	*gen = (Generator){
+		.board = board,
+		.numPipes = numPipes,
+		.rng = board->seed
+	};
+
+	// Everything the search needs is carved out of one block. Besides the
+	// fixed tables and the frame stack, every start frame on the stack
+	// holds a swap log of at most one entry per cell.
+	u64 entries = board->genConfig.useTranspositionTable
+	              ? 1ull << board->genConfig.transpositionBits
+	              : 0;
+	i32 padded = board->numCells;
+	i32 maxFrames = size + numPipes + 1;
+	size_t arenaSize = sizeof(i32) * numPipes
+	                   + sizeof(u64) * (size * 3 + numPipes)
+	                   + sizeof(u64) * entries
+	                   + sizeof(i32) * size * 4
+	                   + (sizeof(i16) + sizeof(u32)) * padded
+	                   + sizeof(GenFrame) * maxFrames
+	                   + sizeof(i32) * size * numPipes
+	                   + 16 * (numPipes + 12);
+	if (!arenaInit(&gen->arena, arenaSize))
+		return false;
+
+	gen->pipes = arenaAlloc(&gen->arena, sizeof(i32) * numPipes);
+	gen->emptyCells = arenaAlloc(&gen->arena, sizeof(i32) * size);
+	gen->emptyPos = arenaAlloc(&gen->arena, sizeof(i32) * size);
+	gen->removedFrom = arenaAlloc(&gen->arena, sizeof(i32) * size);
+
+	gen->stride = board->stride;
+	memcpy(gen->delta, board->delta, sizeof(gen->delta));
+	gen->owner = arenaAlloc(&gen->arena, sizeof(i16) * padded);
+	for (i32 i = 0; i < padded; i++)
+	{
+		bool wall = board->cells[i].state == CELLSTATE_WALL;
+		gen->owner[i] = wall ? GEN_WALL : GEN_EMPTY;
+	}
+	gen->visited = arenaAlloc(&gen->arena, sizeof(u32) * padded);
+	memset(gen->visited, 0, sizeof(u32) * padded);
+	gen->epoch = 0;
+	gen->stack = arenaAlloc(&gen->arena, sizeof(i32) * size);
+	gen->frames = arenaAlloc(&gen->arena, sizeof(GenFrame) * maxFrames);
+
+	// keys come from their own fixed sequence, not from the board seed
+	u64 zobristSeed = 0x666C6F77ull;
+	u64 *zobrist = arenaAlloc(&gen->arena, sizeof(u64) * (size * 3 + numPipes));
+	for (i32 i = 0; i < size * 3 + numPipes; i++)
+	{
+		zobrist[i] = splitMix64(&zobristSeed);
+	}
+	gen->zobristOccupied = zobrist;
+	gen->zobristPipe = zobrist + size;
+	gen->zobristHead = zobrist + size * 2;
+	gen->zobristIndex = zobrist + size * 3;
 
-	bool *rejected = malloc(sizeof(bool) * rejectedSize);
-	for (i32 i = 0; i < rejectedSize; i++)
+	if (entries > 0)
 	{
-		rejected[i] = false;
+		gen->deadStates = arenaAlloc(&gen->arena, sizeof(u64) * entries);
+		memset(gen->deadStates, 0, sizeof(u64) * entries);
+		gen->deadMask = entries - 1;
 	}
 
-	while (true)
+	genBeginAttempt(gen, 1);
+	return true;
+}
+
+// Runs the search until it is decided, at most maxNodes nodes and until
+// the performance counter reaches deadline, 0 leaving either open. True
+// once it is decided with the outcome in gen->placed, false when it
+// wants another call, which includes a paused board.
+bool genStep(Generator *gen, u64 maxNodes, u64 deadline)
+{
+	Board *board = gen->board;
+	u64 firstNode = board->genStats.nodes;
+	u32 steps = 0;
+
+	for (;;)
 	{
-		i32 nonRejectedEmpty = 0;
-		i32 boardSize = board->width * board->height;
-		for (i32 i = 0; i < boardSize; i += 1)
+		while (gen->numFrames > 0)
 		{
-			if (boardGetI(board, i)->state == CELLSTATE_EMPTY && !rejected[i])
-				nonRejectedEmpty += 1;
+			GenFrame *frame = &gen->frames[gen->numFrames - 1];
+			GenStepResult step = genRunFrame(gen, frame);
+			if (step == GENSTEP_YIELD)
+				return false;
+			if (step == GENSTEP_RETURN)
+				gen->numFrames -= 1;
+
+			if (maxNodes > 0 && board->genStats.nodes - firstNode >= maxNodes)
+				return false;
+
+			// reading the clock on every step would cost more than the step
+			if (   deadline > 0
+			    && (++steps & GEN_CLOCK_MASK) == 0
+			    && SDL_GetPerformanceCounter() >= deadline)
+			{
+				return false;
+			}
 		}
 
-		if (nonRejectedEmpty == 0)
+		// a failed attempt unwinds back to an empty board, so the next one
+		// can start right away with new lengths
+		if (   gen->result
+		    || board->genState == GENSTATE_STOPPING
+		    || board->genConfig.restartPolicy == RESTART_NONE)
 		{
-			free(rejected);
-			return false;
+			gen->placed = gen->result;
+			return true;
 		}
+		board->genStats.restarts += 1;
+		genBeginAttempt(gen, gen->attempt + 1);
+	}
+}
 
-		i32 startIndex = 0;
-		i32 startRow = 0;
-		i32 startCol = 0;
-		while (true)
-		{
-			i32 offset = rand() % nonRejectedEmpty;
-			i32 current = 0;
-			for (i32 i = 0; i < boardSize; i += 1)
-			{
-				if (boardGetI(board, i)->state == CELLSTATE_EMPTY
-				    && !rejected[i])
-				{
-					if (current == offset)
-					{
-						startIndex = i;
-						startRow = i / board->width;
-						startCol = i % board->width;
-						break;
-					}
-					current += 1;
-				}
-			}
+void genFinish(Generator *gen)
+{
+	Board *board = gen->board;
+	board->numColors = gen->numPipes;
+	if (board->keepSolution && gen->placed)
+	{
+		memFree(board->pipeLengths);
+		board->pipeLengths = memAlloc(sizeof(i32) * gen->numPipes);
+		memcpy(board->pipeLengths, gen->pipes, sizeof(i32) * gen->numPipes);
+	}
+	arenaFree(&gen->arena);
+}
 
-			if (boardIsEmptyConnected(board, startRow, startCol))
-				break;
-			else
-			{
-				rejected[startIndex] = true;
-				nonRejectedEmpty -= 1;
+// Runs the search on the whole board and leaves the full solution in
+// place, connections included. The caller owns genState and genStats.
+bool genSearch(Board *board)
+{
+	Generator gen;
+	traceBegin("genInit");
+	bool ready = genInit(&gen, board);
+	traceEnd("genInit");
+	if (!ready)
+		return false;
 
-				if (nonRejectedEmpty == 0)
-				{
-					free(rejected);
-					return false;
-				}
-			}
-		}
+	// a paused search hands the thread back, it waits here instead
+	traceBegin("genStep");
+	while (!genStep(&gen, 0, 0))
+	{
+		SDL_Delay(100);
+	}
+	traceEnd("genStep");
 
-		boardGetI(board, startIndex)->state = CELLSTATE_PIPE_START;
-		boardGetI(board, startIndex)->color = currentPipe;
+	genFinish(&gen);
+	return gen.placed;
+}
 
-		bool placed = placePipe(board, pipes, numPipes, currentPipe,
-						        shortestPipeLength, 1, startRow, startCol);
-		if (placed)
+// one tile of a large board, generated on its own by a worker thread
+typedef struct
+{
+	i32 row;
+	i32 col;
+	i32 width;
+	i32 height;
+	i32 firstColor;
+	bool placed;
+	GenStats stats;
+} Region;
+
+typedef struct
+{
+	Board *board;
+	Region *regions;
+	i32 numRegions;
+	SDL_atomic_t next;
+
+	// held while a region is copied in and published, so a snapshot never
+	// catches another worker halfway through its copy
+	SDL_SpinLock publishLock;
+
+	// where each region column and row starts, the board size last
+	i32 *colStarts;
+	i32 *rowStarts;
+	i32 numCols;
+	i32 numRows;
+	i32 numColors;
+} RegionQueue;
+
+// the board a region is generated on, seeded from the large board
+Board* genRegionBegin(RegionQueue *queue, i32 index)
+{
+	Board *board = queue->board;
+	Region *region = &queue->regions[index];
+	Board *sub = boardCreate(region->width, region->height);
+	sub->genConfig = board->genConfig;
+	u64 seedState = board->seed + (u64)index;
+	sub->seed = splitMix64(&seedState) | 1;
+	sub->genState = GENSTATE_GENERATING;
+	sub->parent = board;
+	return sub;
+}
+
+// copies a generated region into the large board and frees it
+void genRegionEnd(RegionQueue *queue, i32 index, Board *sub, bool placed)
+{
+	Board *board = queue->board;
+	Region *region = &queue->regions[index];
+	region->placed = placed;
+	region->stats = sub->genStats;
+
+	SDL_AtomicLock(&queue->publishLock);
+	for (i32 r = 0; r < region->height; r++)
+	{
+		for (i32 c = 0; c < region->width; c++)
 		{
-			free(rejected);
-			return true;
+			Cell *from = boardGet(sub, r, c);
+			Cell *to = boardGet(board, region->row + r, region->col + c);
+			*to = *from;
+			to->color = from->color + region->firstColor;
 		}
-		else
+	}
+	genPublish(board, false);
+	SDL_AtomicUnlock(&queue->publishLock);
+	boardFree(sub);
+}
+
+bool genRegionStopped(Board *board)
+{
+	return board->genState == GENSTATE_STOPREQUESTED
+	    || board->genState == GENSTATE_STOPPING;
+}
+
+i32 genRegionWorker(void *data)
+{
+	RegionQueue *queue = data;
+	Board *board = queue->board;
+
+	for (;;)
+	{
+		i32 index = SDL_AtomicAdd(&queue->next, 1);
+		if (index >= queue->numRegions)
+			break;
+
+		while (board->genState == GENSTATE_PAUSE)
 		{
-			rejected[startIndex] = true;
-			boardGetI(board, startIndex)->state = CELLSTATE_EMPTY;
-			boardGetI(board, startIndex)->color = 0;
+			SDL_Delay(100);
 		}
+
+		// regions that are never generated make the whole board fail
+		if (genRegionStopped(board))
+			continue;
+
+		traceBegin("region");
+		Board *sub = genRegionBegin(queue, index);
+		genRegionEnd(queue, index, sub, genSearch(sub));
+		traceEnd("region");
 	}
+	return 0;
+}
 
-	free(rejected);
-	return false;
+// the threads genLarge starts besides its own, on their own trace track
+i32 genRegionThread(void *data)
+{
+	traceThreadName("region");
+	i32 result = genRegionWorker(data);
+	traceThreadExit();
+	return result;
 }
 
-bool boardGenerate(Board *board)
+// splits length cells into at least LARGE_REGION_SIZE long spans,
+// returns how many and fills in where each one starts
+i32 genSplit(i32 length, i32 *starts)
 {
-	printf("Generating board...\n");
-	u64 startTime = SDL_GetPerformanceCounter();
+	i32 count = length / LARGE_REGION_SIZE;
+	if (count < 1)
+		count = 1;
 
-	i32 numPipes = board->width;
+	i32 start = 0;
+	for (i32 i = 0; i < count; i++)
+	{
+		starts[i] = start;
+		start += length / count + (i < length % count ? 1 : 0);
+	}
+	starts[count] = length;
+	return count;
+}
 
-	board->genState = GENSTATE_GENERATING;
+// the stitching below works on padded cell indices
+i32 genNeighbour(Board *board, i32 index, CellConnection connection)
+{
+	if (connection == CELLCONNECTION_NONE)
+		return -1;
+	return index + board->delta[connection];
+}
+
+CellConnection genConnectionTo(Board *board, i32 from, i32 to)
+{
+	if (to == from - board->stride)
+		return CELLCONNECTION_UP;
+	if (to == from + board->stride)
+		return CELLCONNECTION_DOWN;
+	if (to == from - 1)
+		return CELLCONNECTION_LEFT;
+	return CELLCONNECTION_RIGHT;
+}
+
+// follows the connections from the start of a pipe to its end
+i32 genTracePipe(Board *board, i32 start, i32 *path)
+{
+	i32 length = 0;
+	for (i32 i = start; i >= 0;
+	     i = genNeighbour(board, i, board->cells[i].connection))
+	{
+		path[length++] = i;
+	}
+	return length;
+}
+
+void genReversePipe(Board *board, i32 *path, i32 length)
+{
+	for (i32 i = length - 1; i > 0; i--)
+	{
+		board->cells[path[i]].connection
+		    = genConnectionTo(board, path[i], path[i - 1]);
+	}
+	board->cells[path[0]].connection = CELLCONNECTION_NONE;
+	board->cells[path[0]].state = CELLSTATE_PIPE_END;
+	board->cells[path[length - 1]].state = CELLSTATE_PIPE_START;
 
-	if (numPipes >= CELLCOLOR_COUNT)
+	for (i32 i = 0; i < length / 2; i++)
+	{
+		i32 swap = path[i];
+		path[i] = path[length - 1 - i];
+		path[length - 1 - i] = swap;
+	}
+}
+
+// joins the pipe ending in a with the pipe starting in b, after turning
+// them around as needed. Like a pipe frame the result may not touch itself,
+// every cell keeps exactly its path neighbours in its own color.
+bool genMergePipes(Board *board, i32 *pipeStart, i32 a, i32 b,
+                   i32 *pathP, i32 *pathQ)
+{
+	CellColor p = board->cells[a].color;
+	CellColor q = board->cells[b].color;
+
+	i32 lengthP = genTracePipe(board, pipeStart[p], pathP);
+	if (board->cells[a].state == CELLSTATE_PIPE_START)
+	{
+		genReversePipe(board, pathP, lengthP);
+		pipeStart[p] = pathP[0];
+	}
+
+	i32 lengthQ = genTracePipe(board, pipeStart[q], pathQ);
+	if (board->cells[b].state == CELLSTATE_PIPE_END)
+	{
+		genReversePipe(board, pathQ, lengthQ);
+		pipeStart[q] = pathQ[0];
+	}
+
+	if (lengthP + lengthQ > LARGE_MAX_PIPE_LENGTH)
 		return false;
 
-	i32 size = board->width * board->height;
-	i32 *pipes = malloc(sizeof(i32) * numPipes);
+	for (i32 i = 0; i < lengthQ; i++)
+		board->cells[pathQ[i]].color = p;
 
-	for (i32 i = 0; i < numPipes; i++)
+	bool valid = true;
+	for (i32 i = 0; i < lengthQ && valid; i++)
 	{
-		pipes[i] = 3;
+		i32 degree = (i == lengthQ - 1) ? 1 : 2;
+		if (boardAdjacentWithColorI(board, pathQ[i], p) != degree)
+			valid = false;
 	}
 
-	i32 totalPipeLength = numPipes * 3;
+	if (!valid)
+	{
+		for (i32 i = 0; i < lengthQ; i++)
+			board->cells[pathQ[i]].color = q;
+		return false;
+	}
 
-	while (totalPipeLength < size)
+	board->cells[a].state = CELLSTATE_PIPE;
+	board->cells[a].connection = genConnectionTo(board, a, b);
+	board->cells[b].state = CELLSTATE_PIPE;
+	pipeStart[q] = -1;
+	return true;
+}
+
+bool genIsEndpoint(Cell *cell)
+{
+	return cell->state == CELLSTATE_PIPE_START
+	    || cell->state == CELLSTATE_PIPE_END;
+}
+
+// Lays out the regions of a large board, false if it needs more colors
+// than a cell can hold.
+bool genLargeBegin(RegionQueue *queue, Board *board)
+{
+	i32 width = board->width;
+	i32 *colStarts = memAlloc(sizeof(i32) * (width / LARGE_REGION_SIZE + 2));
+	i32 *rowStarts = memAlloc(sizeof(i32) * (board->height / LARGE_REGION_SIZE + 2));
+	i32 numCols = genSplit(width, colStarts);
+	i32 numRows = genSplit(board->height, rowStarts);
+
+	// every region starts out with as many colors as it is wide
+	if (width * numRows > CELLCOLOR_MAX)
 	{
-		i32 index = rand() % numPipes;
-		pipes[index] += 1;
-		totalPipeLength += 1;
+		fprintf(stderr, "A %ix%i board needs more than %i colors\n",
+		        width, board->height, CELLCOLOR_MAX);
+		memFree(rowStarts);
+		memFree(colStarts);
+		return false;
+	}
+
+	*queue = (RegionQueue){
+		.board = board,
+		.numRegions = numRows * numCols,
+		.regions = memAlloc(sizeof(Region) * numRows * numCols),
+		.publishLock = 0,
+		.colStarts = colStarts,
+		.rowStarts = rowStarts,
+		.numCols = numCols,
+		.numRows = numRows
+	};
+	SDL_AtomicSet(&queue->next, 0);
+
+	for (i32 r = 0; r < numRows; r++)
+	{
+		for (i32 c = 0; c < numCols; c++)
+		{
+			Region *region = &queue->regions[r * numCols + c];
+			*region = (Region){
+				.row = rowStarts[r],
+				.col = colStarts[c],
+				.width = colStarts[c + 1] - colStarts[c],
+				.height = rowStarts[r + 1] - rowStarts[r],
+				.firstColor = queue->numColors
+			};
+			queue->numColors += region->width;
+		}
+	}
+	return true;
+}
+
+// Once every region is in: sums up their stats, joins pipes across the
+// seams and frees the queue.
+bool genLargeEnd(RegionQueue *queue)
+{
+	Board *board = queue->board;
+	i32 width = board->width;
+	i32 size = width * board->height;
+	i32 *colStarts = queue->colStarts;
+	i32 *rowStarts = queue->rowStarts;
+	i32 numCols = queue->numCols;
+	i32 numRows = queue->numRows;
+	i32 numColors = queue->numColors;
+
+	bool placed = true;
+	for (i32 i = 0; i < queue->numRegions; i++)
+	{
+		GenStats *stats = &queue->regions[i].stats;
+		board->genStats.nodes += stats->nodes;
+		board->genStats.backtracks += stats->backtracks;
+		board->genStats.restarts += stats->restarts;
+		board->genStats.ttProbes += stats->ttProbes;
+		board->genStats.ttHits += stats->ttHits;
+		board->genStats.ttStores += stats->ttStores;
+		if (!queue->regions[i].placed)
+			placed = false;
+	}
+	board->genStats.regions = queue->numRegions;
+	if (board->genState == GENSTATE_STOPREQUESTED)
+		board->genState = GENSTATE_STOPPING;
+
+	// every seam cell pair whose ends belong to two pipes
+	i32 numSeams = (numCols - 1) * board->height + (numRows - 1) * width;
+	i32 *seams = memAlloc(sizeof(i32) * 2 * (numSeams + 1));
+	i32 numPairs = 0;
+	for (i32 c = 1; c < numCols && placed; c++)
+	{
+		for (i32 r = 0; r < board->height; r++)
+		{
+			i32 a = boardIndex(board, r, colStarts[c] - 1);
+			if (   genIsEndpoint(&board->cells[a])
+			    && genIsEndpoint(&board->cells[a + 1]))
+			{
+				seams[numPairs * 2] = a;
+				seams[numPairs * 2 + 1] = a + 1;
+				numPairs += 1;
+			}
+		}
+	}
+	for (i32 r = 1; r < numRows && placed; r++)
+	{
+		for (i32 c = 0; c < width; c++)
+		{
+			i32 a = boardIndex(board, rowStarts[r] - 1, c);
+			i32 b = a + board->stride;
+			if (   genIsEndpoint(&board->cells[a])
+			    && genIsEndpoint(&board->cells[b]))
+			{
+				seams[numPairs * 2] = a;
+				seams[numPairs * 2 + 1] = b;
+				numPairs += 1;
+			}
+		}
 	}
 
-	i32 shortestPipeLength = INT_MAX;
-	for (i32 i = 0; i < numPipes; i++)
+	i32 *pipeStart = memAlloc(sizeof(i32) * numColors);
+	i32 *pathP = memAlloc(sizeof(i32) * size);
+	i32 *pathQ = memAlloc(sizeof(i32) * size);
+	for (i32 i = 0; i < board->numCells; i++)
 	{
-		if (pipes[i] < shortestPipeLength)
-			shortestPipeLength = pipes[i];
+		if (board->cells[i].state == CELLSTATE_PIPE_START)
+			pipeStart[board->cells[i].color] = i;
 	}
 
-	bool placed = placeStart(board, pipes, numPipes, 0, shortestPipeLength);
+	u64 rng = board->seed;
+	for (i32 i = numPairs - 1; i > 0; i--)
+	{
+		i32 j = (i32)(splitMix64(&rng) % (u64)(i + 1));
+		i32 a = seams[i * 2];
+		i32 b = seams[i * 2 + 1];
+		seams[i * 2] = seams[j * 2];
+		seams[i * 2 + 1] = seams[j * 2 + 1];
+		seams[j * 2] = a;
+		seams[j * 2 + 1] = b;
+	}
+
+	for (i32 i = 0; i < numPairs; i++)
+	{
+		i32 a = seams[i * 2];
+		i32 b = seams[i * 2 + 1];
+
+		// either end may have been used up by an earlier merge
+		if (   genIsEndpoint(&board->cells[a])
+		    && genIsEndpoint(&board->cells[b])
+		    && genMergePipes(board, pipeStart, a, b, pathP, pathQ))
+		{
+			board->genStats.merges += 1;
+		}
+	}
+
+	// number the remaining pipes from 0 again, in reading order
+	for (i32 i = 0; i < numColors; i++)
+		pipeStart[i] = -1;
+	board->numColors = 0;
+	for (Cell *c = board->cells; c < board->cells+board->numCells && placed; c++)
+	{
+		if (c->state == CELLSTATE_WALL)
+			continue;
+		if (pipeStart[c->color] < 0)
+			pipeStart[c->color] = board->numColors++;
+		c->color = pipeStart[c->color];
+	}
+
+	memFree(pathQ);
+	memFree(pathP);
+	memFree(pipeStart);
+	memFree(seams);
+	memFree(queue->regions);
+	memFree(rowStarts);
+	memFree(colStarts);
+	return placed;
+}
+
+// Generates a large board as a grid of regions on all cores. Every region
+// is a complete board of its own, so the seams would show as a wall no
+// pipe crosses; pipes whose ends meet across a seam are joined afterwards
+// in random order. The board keeps its full solution like genSearch.
+bool genLarge(Board *board)
+{
+	RegionQueue queue;
+	traceBegin("genLargeBegin");
+	bool ready = genLargeBegin(&queue, board);
+	traceEnd("genLargeBegin");
+	if (!ready)
+		return false;
+
+	// the calling thread works through the queue as well
+#ifdef FLOW_NO_THREADS
+	i32 numThreads = 1;
+#else
+	i32 numThreads = SDL_GetCPUCount();
+#endif
+	if (numThreads > queue.numRegions)
+		numThreads = queue.numRegions;
+	SDL_Thread **threads = memAlloc(sizeof(SDL_Thread*) * numThreads);
+	for (i32 i = 1; i < numThreads; i++)
+	{
+		threads[i] = SDL_CreateThread(genRegionThread, "region", &queue);
+	}
+	genRegionWorker(&queue);
+	for (i32 i = 1; i < numThreads; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+	}
+	memFree(threads);
+
+	traceBegin("genLargeEnd");
+	bool placed = genLargeEnd(&queue);
+	traceEnd("genLargeEnd");
+	return placed;
+}
+
+bool boardIsLarge(Board *board)
+{
+	return board->width >= LARGE_BOARD_SIZE
+	    || board->height >= LARGE_BOARD_SIZE;
+}
+
+// the part of boardGenerate before the search, returns when it started
+u64 genPrepare(Board *board)
+{
+	if (!board->quiet)
+		printf("Generating board...\n");
+	u64 startTime = SDL_GetPerformanceCounter();
+
+	// a board handed to the pool may have been paused or stopped before
+	// its job started
+	if (board->genState == GENSTATE_IDLE)
+		board->genState = GENSTATE_GENERATING;
+	board->genStats = (GenStats){0};
 
+	// a board is fully determined by its seed, 0 asks for a fresh one
+	if (board->seed == 0)
+		board->seed = ((u64)rand() << 32) ^ (u64)rand() ^ 1;
+
+	return startTime;
+}
+
+// the part of boardGenerate after the search: turns the solution into
+// the puzzle and hands the board back
+bool genComplete(Board *board, bool placed, u64 startTime)
+{
+	u64 endTime = SDL_GetPerformanceCounter();
+	board->genStats.seconds
+	    = (endTime - startTime) / (f64)SDL_GetPerformanceFrequency();
+
+	Cell *end = board->cells + board->numCells;
 	if (board->genState == GENSTATE_STOPPING)
 	{
-		for (Cell *c = board->cells; c < board->cells+size; c++)
+		for (Cell *c = board->cells; c < end; c++)
 		{
+			if (c->state == CELLSTATE_WALL)
+				continue;
 			c->state = CELLSTATE_EMPTY;
 			c->connection = CELLCONNECTION_NONE;
 		}
 		placed = false;
 	}
-	else
+	else if (placed)
 	{
-		for (Cell *c = board->cells; c < board->cells+size; c++)
+		// kept solved for boardValidate, see keepSolution
+		for (Cell *c = board->cells; c < end && !board->keepSolution; c++)
 		{
 			if (   c->state != CELLSTATE_PIPE_START
-				&& c->state != CELLSTATE_PIPE_END)
+				&& c->state != CELLSTATE_PIPE_END
+				&& c->state != CELLSTATE_WALL)
 			{
 				c->state = CELLSTATE_EMPTY;
 			}
 			c->connection = CELLCONNECTION_NONE;
 		}
-		printf("Generated!\n");
-		u64 endTime = SDL_GetPerformanceCounter();
-		printf("Time taken: %f\n",
-		    (endTime - startTime) / (f64)SDL_GetPerformanceFrequency());
+		if (!board->quiet)
+		{
+			printf("Generated!\n");
+			printf("Time taken: %f\n", board->genStats.seconds);
+			printf("Seed: %llu\n", (unsigned long long)board->seed);
+			printf("Nodes: %llu, backtracks: %llu, restarts: %llu, "
+			       "dead-state hits: %llu/%llu (%.1f%%)\n",
+			    (unsigned long long)board->genStats.nodes,
+			    (unsigned long long)board->genStats.backtracks,
+			    (unsigned long long)board->genStats.restarts,
+			    (unsigned long long)board->genStats.ttHits,
+			    (unsigned long long)board->genStats.ttProbes,
+			    board->genStats.ttProbes
+			        ? 100.0 * board->genStats.ttHits / board->genStats.ttProbes
+			        : 0.0);
+			if (board->genStats.regions > 0)
+			{
+				printf("Regions: %llu, seams merged: %llu, colors: %i\n",
+				    (unsigned long long)board->genStats.regions,
+				    (unsigned long long)board->genStats.merges,
+				    board->numColors);
+			}
+		}
 	}
 
-	free(pipes);
+	// the last snapshot is the board as it is handed over
+	genPublish(board, true);
 	board->genState = GENSTATE_IDLE;
 	return placed;
 }
 
+bool boardGenerate(Board *board)
+{
+	traceBegin("boardGenerate");
+	u64 startTime = genPrepare(board);
+	bool placed = boardIsLarge(board) ? genLarge(board) : genSearch(board);
+
+	traceBegin("genComplete");
+	placed = genComplete(board, placed, startTime);
+	traceEnd("genComplete");
+	traceEnd("boardGenerate");
+	return placed;
+}
 
+struct BoardGen
+{
+	Board *board;
+	u64 startTime;
+	bool done;
+	bool placed;
+
+	// the search under way, on the board itself or on the region being
+	// generated when the board is large
+	Generator gen;
+	bool searching;
+
+	// large boards are generated one region after the other
+	bool large;
+	RegionQueue queue;
+	i32 region;
+	Board *sub;
+};
+
+BoardGen* boardGenerateBegin(Board *board)
+{
+	BoardGen *ctx = memCalloc(1, sizeof(BoardGen));
+	ctx->board = board;
+	ctx->startTime = genPrepare(board);
+	ctx->large = boardIsLarge(board);
 
+	if (ctx->large)
+		ctx->done = !genLargeBegin(&ctx->queue, board);
+	else
+		ctx->done = !genInit(&ctx->gen, board);
+	return ctx;
+}
 
+bool boardGenerateStep(BoardGen *ctx, u64 maxNodes, u64 maxMicros)
+{
+	Board *board = ctx->board;
+	if (ctx->done)
+		return true;
+	if (board->genState == GENSTATE_PAUSE)
+		return false;
 
+	u64 deadline = 0;
+	if (maxMicros > 0)
+	{
+		deadline = SDL_GetPerformanceCounter()
+		           + maxMicros * SDL_GetPerformanceFrequency() / 1000000;
+	}
 
+	if (!ctx->large)
+	{
+		if (genStep(&ctx->gen, maxNodes, deadline))
+		{
+			genFinish(&ctx->gen);
+			ctx->placed = ctx->gen.placed;
+			ctx->done = true;
+		}
+		return ctx->done;
+	}
 
+	while (!ctx->done)
+	{
+		if (!ctx->sub)
+		{
+			if (ctx->region == ctx->queue.numRegions)
+			{
+				ctx->placed = genLargeEnd(&ctx->queue);
+				ctx->done = true;
+				break;
+			}
 
+			// regions that are never generated make the whole board fail
+			if (genRegionStopped(board))
+			{
+				ctx->region += 1;
+				continue;
+			}
 
+			ctx->sub = genRegionBegin(&ctx->queue, ctx->region);
+			ctx->searching = genInit(&ctx->gen, ctx->sub);
+		}
 
+		bool placed = false;
+		if (ctx->searching)
+		{
+			if (!genStep(&ctx->gen, maxNodes, deadline))
+				return false;
+			genFinish(&ctx->gen);
+			placed = ctx->gen.placed
+			         && ctx->sub->genState != GENSTATE_STOPPING;
+		}
+		genRegionEnd(&ctx->queue, ctx->region, ctx->sub, placed);
+		ctx->sub = NULL;
+		ctx->region += 1;
 
+		if (deadline > 0 && SDL_GetPerformanceCounter() >= deadline)
+			return false;
+	}
+	return true;
+}
 
+bool boardGenerateEnd(BoardGen *ctx)
+{
+	// an unfinished run is stopped the way genJobCancel stops a job
+	if (!ctx->done)
+	{
+		ctx->board->genState = GENSTATE_STOPREQUESTED;
+		while (!boardGenerateStep(ctx, 0, 0))
+			;
+	}
 
+	bool placed = genComplete(ctx->board, ctx->placed, ctx->startTime);
+	memFree(ctx);
+	return placed;
+}
 
+const char* boardGenStateName(GenState state)
+{
+	switch (state)
+	{
+		case GENSTATE_IDLE:
+			return "idle";
+		case GENSTATE_GENERATING:
+			return "generating";
+		case GENSTATE_PAUSE:
+			return "paused";
+		case GENSTATE_STOPREQUESTED:
+			return "stop requested";
+		case GENSTATE_STOPPING:
+			return "stopping";
+		default:
+			return "unknown";
+	}
+}
 
+const char* boardRestartPolicyName(RestartPolicy policy)
+{
+	switch (policy)
+	{
+		case RESTART_NONE:
+			return "none";
+		case RESTART_LUBY:
+			return "luby";
+		case RESTART_GEOMETRIC:
+			return "geometric";
+		default:
+			return "unknown";
+	}
+}
 
+const char* boardMoveOrderName(MoveOrder order)
+{
+	switch (order)
+	{
+		case MOVEORDER_RANDOM:
+			return "random";
+		case MOVEORDER_WARNSDORFF:
+			return "warnsdorff";
+		default:
+			return "unknown";
+	}
+}
 
-
+const char* boardStartOrderName(StartOrder order)
+{
+	switch (order)
+	{
+		case STARTORDER_RANDOM:
+			return "random";
+		case STARTORDER_CONSTRAINED:
+			return "constrained";
+		default:
+			return "unknown";
+	}
+}
@@ -4,6 +4,11 @@
 #include <stdbool.h>
 #include "common.h"
 
+// boards this wide or high are generated as a grid of independent regions
+// of about LARGE_REGION_SIZE cells a side, see boardGenerate
+#define LARGE_BOARD_SIZE 16
+#define LARGE_REGION_SIZE 8
+
 typedef enum
 {
 	DIRECTION_UP = 0,
@@ -12,32 +17,10 @@ typedef enum
 	DIRECTION_RIGHT = 3
 } Direction;
 
-typedef enum
-{
-	CELLCOLOR_RED,
-	CELLCOLOR_GREEN,
-	CELLCOLOR_BLUE,
-	CELLCOLOR_YELLOW,
-	CELLCOLOR_PURPLE,
-	CELLCOLOR_CYAN,
-	CELLCOLOR_WHITE,
-	CELLCOLOR_LIGHT_GRAY,
-	CELLCOLOR_MEDIUM_GRAY,
-	CELLCOLOR_DARK_GRAY,
-	CELLCOLOR_MAGENTA,
-	CELLCOLOR_PINK,
-	CELLCOLOR_DARK_RED,
-	CELLCOLOR_DARK_GREEN,
-	CELLCOLOR_DARK_BLUE,
-	CELLCOLOR_ULTRADARK_RED,
-	CELLCOLOR_ULTRADARK_GREEN,
-	CELLCOLOR_ULTRADARK_BLUE,
-	CELLCOLOR_ULTRADARK_YELLOW,
-	CELLCOLOR_ULTRADARK_PURPLE,
-	CELLCOLOR_ULTRADARK_CYAN,
-	CELLCOLOR_FUCHSIA,
-	CELLCOLOR_COUNT
-} CellColor;
+// index into the renderer's palette, one per pipe, so a board can have as
+// many pipes as fit in CellColor
+typedef u16 CellColor;
+#define CELLCOLOR_MAX UINT16_MAX
 
 typedef enum
 {
@@ -46,6 +29,7 @@ typedef enum
 	CELLSTATE_PIPE_START,
 	CELLSTATE_PIPE_END,
 	CELLSTATE_PIPE,
+	CELLSTATE_WALL,
 	CELLSTATE_COUNT
 } CellState;
 
@@ -68,11 +52,12 @@ typedef enum
 	GENSTATE_STOPPING
 } GenState;
 
+// large boards hold a lot of these, so the enums are stored in a byte each
 typedef struct
 {
-	CellState state;
+	u8 state;
+	u8 connection;
 	CellColor color;
-	CellConnection connection;
 } Cell;
 
 typedef struct
@@ -82,18 +67,116 @@ typedef struct
 } Vec2i;
 
 
+typedef enum
+{
+	RESTART_NONE,
+	RESTART_LUBY,
+	RESTART_GEOMETRIC
+} RestartPolicy;
+
+typedef enum
+{
+	MOVEORDER_RANDOM,
+	MOVEORDER_WARNSDORFF,
+	MOVEORDER_COUNT
+} MoveOrder;
+
+typedef enum
+{
+	STARTORDER_RANDOM,
+	STARTORDER_CONSTRAINED,
+	STARTORDER_COUNT
+} StartOrder;
+
+// counters filled in by boardGenerate
+typedef struct
+{
+	u64 nodes;
+	u64 backtracks;
+	u64 restarts;
+	u64 ttProbes;
+	u64 ttHits;
+	u64 ttStores;
+	u64 regions;
+	u64 merges;
+	f64 seconds;
+} GenStats;
+
 typedef struct
 {
+	// remember failed subtrees in a lossy table of 1 << transpositionBits
+	// Zobrist keys and cut them off when they are reached again
+	bool useTranspositionTable;
+	i32 transpositionBits;
+
+	// give up on an attempt after restartBase nodes times the policy's
+	// multiplier for that attempt, then start over with new pipe lengths
+	RestartPolicy restartPolicy;
+	u64 restartBase;
+	f64 restartFactor;
+
+	// which extension of a pipe and which start cell to try first, both
+	// stay random among equally good choices
+	MoveOrder moveOrder;
+	StartOrder startOrder;
+} GenConfig;
+
+typedef struct Snapshots Snapshots;
+
+typedef struct Board
+{
+	// (width + 2) x (height + 2) cells: the board plus a ring of
+	// CELLSTATE_WALL, so a neighbour is always cells[index + delta[d]] for
+	// CellConnection d. Walls inside the ring block single cells.
 	Cell *cells;
+	i32 stride;
+	i32 numCells;
+	i32 delta[4];
 	i32 width;
 	i32 height;
 	GenState genState;
+	// the large board a region's board is part of, whose stop requests
+	// and pauses its search follows; NULL for every other board
+	struct Board *parent;
+	// distinct pipe colors of the generated board
+	i32 numColors;
+	u64 seed;
+	GenConfig genConfig;
+	GenStats genStats;
+
+	// For checking the generator: keepSolution has boardGenerate hand the
+	// board over solved, connections included, instead of blanked to its
+	// endpoints, with pipeLengths the length genAssignPipes gave every
+	// pipe. Large boards have no pipeLengths, their pipes are joined
+	// across regions. quiet keeps boardGenerate from printing.
+	bool keepSolution;
+	i32 *pipeLengths;
+	bool quiet;
+
+	// copies of the cells the generator hands out while it runs, NULL
+	// unless boardEnableSnapshots was called
+	Snapshots *snapshots;
+
+	// boardEmptyPathExists scratch, allocated on its first query: the
+	// epoch each side last reached a cell in and both search queues
+	u32 *pathVisited;
+	u32 pathEpoch;
+	i32 *pathQueue;
 } Board;
 
 Board* boardCreate(i32 width, i32 height);
 
+GenConfig boardDefaultGenConfig(void);
+
 void boardFree(Board *board);
 
+// has boardGenerate publish its progress, see snapshot.h
+void boardEnableSnapshots(Board *board);
+
+// cells that are safe to read while the board is generated in another
+// thread, the board's own cells when it is not
+const Cell* boardSnapshot(Board *board);
+
 void boardSetColor(Board *board, i32 r, i32 c, CellColor color);
 
 void boardSetColorAll(Board *board, CellColor color);
@@ -104,14 +187,57 @@ void boardSetStateAll(Board *board, CellState state);
 
 Cell* boardGet(Board *board, i32 r, i32 c);
 
+// index is into the padded cells, see boardIndex
 Cell* boardGetI(Board *board, i32 index);
 
+i32 boardIndex(Board *board, i32 r, i32 c);
+
 bool boardBoundsCheck(Board *board, i32 r, i32 c);
 
+// a pipe end or a cell a pipe runs through
+bool boardIsPipe(Cell *cell);
+
 void boardPrint(Board *board);
 
+// Checks a board boardGenerate left solved, see keepSolution: every cell
+// is covered, every color has one PIPE_START and one PIPE_END joined by
+// its connections, no pipe touches itself and every pipe is as long as
+// pipeLengths says, or at least 3 cells without them. NULL when it holds,
+// otherwise what is wrong.
+const char* boardValidate(Board *board);
+
 bool boardGenerate(Board *board);
 
+// the next number of the SplitMix64 sequence state is at, which is how
+// the generator derives every seed it needs from the board's
+u64 splitMix64(u64 *state);
+
+typedef struct BoardGen BoardGen;
+
+// boardGenerate in slices, for builds without threads: Begin sets up the
+// run, every Step runs it for at most maxNodes search nodes or maxMicros
+// microseconds (0 leaves either open) and returns true once it is done,
+// End returns what boardGenerate would have and frees the context. A
+// seed gives the same board either way. End on an unfinished run stops it.
+BoardGen* boardGenerateBegin(Board *board);
+
+bool boardGenerateStep(BoardGen *gen, u64 maxNodes, u64 maxMicros);
+
+bool boardGenerateEnd(BoardGen *gen);
+
+const char* boardGenStateName(GenState state);
+
+const char* boardRestartPolicyName(RestartPolicy policy);
+
+const char* boardMoveOrderName(MoveOrder order);
+
+const char* boardStartOrderName(StartOrder order);
+
+// Whether a path of empty cells joins (r1, c1) to (r2, c2), so a pipe
+// with its ends there could still be laid. The two cells themselves may
+// hold anything but a wall; next to each other they are always joined.
+// Searches from both ends at once and reuses its scratch between queries,
+// so it is cheap enough to ask in a search's inner loop.
 bool boardEmptyPathExists(Board *board, i32 r1, i32 c1, i32 r2, i32 c2);
 
 #endif
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "camera.h"
+#include "mem.h"
+
+// the colors playDraw gives empty cells and the board behind them
+#define CELLTEXTURE_EMPTY 0xff000000u
+#define CELLTEXTURE_WALL 0xff191919u
+
+// rounds towards minus infinity, for positions left of or above the board
+static i32 cameraFloor(f32 value)
+{
+	i32 truncated = (i32)value;
+	return value < truncated ? truncated - 1 : truncated;
+}
+
+// keeps the board covering the view where it is big enough to, and where
+// it is not, in its top left corner as zoom 1 has it
+static void cameraClamp(Camera *camera)
+{
+	f32 width = camera->cols * camera->cellWidth;
+	f32 height = camera->rows * camera->cellHeight;
+	f32 left = camera->view.x + camera->view.w - width;
+	f32 top = camera->view.y + camera->view.h - height;
+
+	if (camera->x < left)
+		camera->x = left;
+	if (camera->x > camera->view.x || width <= camera->view.w)
+		camera->x = camera->view.x;
+	if (camera->y < top)
+		camera->y = top;
+	if (camera->y > camera->view.y || height <= camera->view.h)
+		camera->y = camera->view.y;
+}
+
+void cameraInit(Camera *camera, SDL_Rect view, i32 cols, i32 rows)
+{
+	*camera = (Camera){
+		.view = view,
+		.cols = cols,
+		.rows = rows,
+		.fitWidth = (f32)view.w / cols,
+		.fitHeight = (f32)view.h / rows,
+		.zoom = 1.0f,
+		.x = view.x,
+		.y = view.y
+	};
+	camera->cellWidth = camera->fitWidth;
+	camera->cellHeight = camera->fitHeight;
+}
+
+void cameraZoom(Camera *camera, f32 factor, i32 x, i32 y)
+{
+	f32 fit = camera->fitWidth < camera->fitHeight
+	          ? camera->fitWidth
+	          : camera->fitHeight;
+	f32 maxZoom = CAMERA_MAX_CELL_SIZE / fit;
+	f32 zoom = camera->zoom * factor;
+	if (zoom > maxZoom)
+		zoom = maxZoom;
+	if (zoom < 1.0f)
+		zoom = 1.0f;
+
+	// the board position under (x, y), in cells, stays put
+	f32 col = (x - camera->x) / camera->cellWidth;
+	f32 row = (y - camera->y) / camera->cellHeight;
+	camera->zoom = zoom;
+	camera->cellWidth = camera->fitWidth * zoom;
+	camera->cellHeight = camera->fitHeight * zoom;
+	camera->x = x - col * camera->cellWidth;
+	camera->y = y - row * camera->cellHeight;
+	cameraClamp(camera);
+}
+
+void cameraPan(Camera *camera, i32 dx, i32 dy)
+{
+	camera->x += dx;
+	camera->y += dy;
+	cameraClamp(camera);
+}
+
+bool cameraIsDetailed(const Camera *camera)
+{
+	return camera->cellWidth >= CAMERA_LOD_CELL_SIZE
+	    && camera->cellHeight >= CAMERA_LOD_CELL_SIZE;
+}
+
+SDL_Rect cameraCellRect(const Camera *camera, i32 row, i32 col)
+{
+	i32 left = cameraFloor(camera->x + col * camera->cellWidth);
+	i32 right = cameraFloor(camera->x + (col + 1) * camera->cellWidth);
+	i32 top = cameraFloor(camera->y + row * camera->cellHeight);
+	i32 bottom = cameraFloor(camera->y + (row + 1) * camera->cellHeight);
+	return (SDL_Rect){left, top, right - left, bottom - top};
+}
+
+SDL_Rect cameraBoardRect(const Camera *camera)
+{
+	SDL_Rect first = cameraCellRect(camera, 0, 0);
+	SDL_Rect last = cameraCellRect(camera, camera->rows - 1, camera->cols - 1);
+	return (SDL_Rect){
+		first.x,
+		first.y,
+		last.x + last.w - first.x,
+		last.y + last.h - first.y
+	};
+}
+
+SDL_Point cameraCellAt(const Camera *camera, i32 x, i32 y)
+{
+	return (SDL_Point){
+		cameraFloor((x - camera->x) / camera->cellWidth),
+		cameraFloor((y - camera->y) / camera->cellHeight)
+	};
+}
+
+SDL_Rect cameraVisibleCells(const Camera *camera)
+{
+	SDL_Point first = cameraCellAt(camera, camera->view.x, camera->view.y);
+	// the far edge rather than the last pixel, a cell starting part way
+	// into that pixel still shows
+	SDL_Point last = cameraCellAt(camera,
+	                              camera->view.x + camera->view.w,
+	                              camera->view.y + camera->view.h);
+	if (first.x < 0)
+		first.x = 0;
+	if (first.y < 0)
+		first.y = 0;
+	if (last.x > camera->cols - 1)
+		last.x = camera->cols - 1;
+	if (last.y > camera->rows - 1)
+		last.y = camera->rows - 1;
+	return (SDL_Rect){
+		first.x,
+		first.y,
+		last.x >= first.x ? last.x - first.x + 1 : 0,
+		last.y >= first.y ? last.y - first.y + 1 : 0
+	};
+}
+
+bool cellTextureInit(CellTexture *texture, SDL_Renderer *renderer,
+                     i32 width, i32 height)
+{
+	*texture = (CellTexture){
+		.width = width,
+		.height = height,
+		.dirtyBottom = -1
+	};
+	texture->texture = memTexture(
+	    SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+	                      SDL_TEXTUREACCESS_STREAMING, width, height));
+	texture->pixels = memAlloc(sizeof(u32) * width * height);
+	if (!texture->texture || !texture->pixels)
+	{
+		cellTextureFree(texture);
+		return false;
+	}
+	SDL_SetTextureScaleMode(texture->texture, SDL_ScaleModeNearest);
+
+	// the texture starts out undefined, so the first update uploads it all
+	memset(texture->pixels, 0, sizeof(u32) * width * height);
+	cellTextureTouch(texture, 0, height - 1);
+	return true;
+}
+
+void cellTextureFree(CellTexture *texture)
+{
+	if (texture->texture)
+		memDestroyTexture(texture->texture);
+	memFree(texture->pixels);
+	*texture = (CellTexture){.dirtyBottom = -1};
+}
+
+void cellTextureTouch(CellTexture *texture, i32 first, i32 last)
+{
+	if (first < 0)
+		first = 0;
+	if (last > texture->height - 1)
+		last = texture->height - 1;
+	if (first > last)
+		return;
+
+	if (texture->dirtyBottom < texture->dirtyTop)
+	{
+		texture->dirtyTop = first;
+		texture->dirtyBottom = last;
+		return;
+	}
+	if (first < texture->dirtyTop)
+		texture->dirtyTop = first;
+	if (last > texture->dirtyBottom)
+		texture->dirtyBottom = last;
+}
+
+void cellTextureUpdate(CellTexture *texture, const Cell *cells, i32 stride,
+                       Palette *palette)
+{
+	for (i32 r = texture->dirtyTop; r <= texture->dirtyBottom; r++)
+	{
+		u32 *row = &texture->pixels[r * texture->width];
+		const Cell *cell = &cells[(r + 1) * stride + 1];
+		i32 first = texture->width;
+		i32 last = -1;
+
+		for (i32 c = 0; c < texture->width; c++, cell++)
+		{
+			u32 pixel = CELLTEXTURE_EMPTY;
+			if (cell->state == CELLSTATE_WALL)
+			{
+				pixel = CELLTEXTURE_WALL;
+			}
+			else if (cell->state != CELLSTATE_EMPTY)
+			{
+				SDL_Color color = paletteColor(palette, cell->color);
+				pixel = 0xff000000u | (u32)color.r << 16
+				        | (u32)color.g << 8 | color.b;
+			}
+			if (row[c] != pixel)
+			{
+				row[c] = pixel;
+				if (c < first)
+					first = c;
+				last = c;
+			}
+		}
+
+		if (last >= first)
+		{
+			SDL_Rect span = {first, r, last - first + 1, 1};
+			SDL_UpdateTexture(texture->texture, &span, &row[first],
+			                  sizeof(u32) * texture->width);
+		}
+	}
+	// empty again
+	texture->dirtyTop = 0;
+	texture->dirtyBottom = -1;
+}
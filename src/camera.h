@@ -0,0 +1,85 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+#include "palette.h"
+
+// below this many pixels a side cells are drawn from a CellTexture, one
+// texel each, instead of one by one
+#define CAMERA_LOD_CELL_SIZE 6
+
+// the closest the camera goes, in pixels a side of a cell
+#define CAMERA_MAX_CELL_SIZE 160
+
+// each wheel notch zooms by this factor
+#define CAMERA_ZOOM_STEP 1.25f
+
+// Where the board is drawn: view is the rect of the window it is drawn
+// in, x and y where the board's top left corner is, which may be outside
+// view, and cellWidth by cellHeight the size of a cell in pixels. Zoom 1
+// fits the whole board in view.
+typedef struct
+{
+	SDL_Rect view;
+	i32 cols;
+	i32 rows;
+	f32 fitWidth;
+	f32 fitHeight;
+	f32 zoom;
+	f32 cellWidth;
+	f32 cellHeight;
+	f32 x;
+	f32 y;
+} Camera;
+
+void cameraInit(Camera *camera, SDL_Rect view, i32 cols, i32 rows);
+
+// zooms by factor, keeping the board under window position (x, y) there
+void cameraZoom(Camera *camera, f32 factor, i32 x, i32 y);
+
+void cameraPan(Camera *camera, i32 dx, i32 dy);
+
+// false when cells are too small to draw one by one, see CellTexture
+bool cameraIsDetailed(const Camera *camera);
+
+// the window rect of a cell, neighbours share their edges exactly
+SDL_Rect cameraCellRect(const Camera *camera, i32 row, i32 col);
+
+// the window rect of the whole board
+SDL_Rect cameraBoardRect(const Camera *camera);
+
+// the cell under a window position, also past the edges of the board
+SDL_Point cameraCellAt(const Camera *camera, i32 x, i32 y);
+
+// the cells at least partly in view, x and w for columns, y and h for rows
+SDL_Rect cameraVisibleCells(const Camera *camera);
+
+// The board at one texel a cell, for drawing it when the cells are
+// smaller than CAMERA_LOD_CELL_SIZE. Rows are marked dirty as the board
+// changes and only the cells in them that changed color are uploaded.
+typedef struct
+{
+	SDL_Texture *texture;
+	u32 *pixels;
+	i32 width;
+	i32 height;
+	i32 dirtyTop;
+	i32 dirtyBottom;
+} CellTexture;
+
+bool cellTextureInit(CellTexture *texture, SDL_Renderer *renderer,
+                     i32 width, i32 height);
+
+void cellTextureFree(CellTexture *texture);
+
+// rows first to last, inclusive, may have changed
+void cellTextureTouch(CellTexture *texture, i32 first, i32 last);
+
+// brings the dirty rows up to date with cells, padded like Board cells
+void cellTextureUpdate(CellTexture *texture, const Cell *cells, i32 stride,
+                       Palette *palette);
+
+#endif
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "check.h"
+#include "mem.h"
+
+// boards asked for on the command line may be no bigger than this a side
+#define CHECK_MAX_SIZE 1024
+
+// fuzzer input: width, height, variant, then the seed's 8 bytes
+#define CHECK_FUZZ_INPUT 11
+
+// boards the fuzzer asks for are no bigger than this a side, which still
+// reaches large boards
+#define CHECK_FUZZ_MAX_SIZE 24
+
+typedef struct
+{
+	u64 seed;
+	i32 count;
+	i32 minSize;
+	i32 maxSize;
+
+	// the index of the next case to check
+	SDL_atomic_t next;
+
+	SDL_SpinLock lock;
+	i32 numFailed;
+	CheckCase failed[CHECK_MAX_REPORTED];
+} CheckQueue;
+
+GenConfig checkConfig(i32 variant)
+{
+	GenConfig config = boardDefaultGenConfig();
+	config.useTranspositionTable = (variant & 1) == 0;
+	config.moveOrder = variant & 2 ? MOVEORDER_RANDOM : MOVEORDER_WARNSDORFF;
+	config.startOrder = variant & 4 ? STARTORDER_RANDOM
+	                                : STARTORDER_CONSTRAINED;
+	switch (variant / 8)
+	{
+		case 1:
+			config.restartPolicy = RESTART_GEOMETRIC;
+			break;
+		case 2:
+			config.restartPolicy = RESTART_NONE;
+			break;
+		default:
+			config.restartPolicy = RESTART_LUBY;
+			break;
+	}
+	return config;
+}
+
+const char* checkCase(CheckCase *check)
+{
+	Board *board = boardCreate(check->width, check->height);
+	board->seed = check->seed;
+	board->genConfig = checkConfig(check->variant);
+	if (   check->width > CHECK_SLOW_MAX_SIZE
+	    || check->height > CHECK_SLOW_MAX_SIZE)
+	{
+		GenConfig fast = boardDefaultGenConfig();
+		board->genConfig.moveOrder = fast.moveOrder;
+		board->genConfig.startOrder = fast.startOrder;
+		if (board->genConfig.restartPolicy == RESTART_NONE)
+			board->genConfig.restartPolicy = fast.restartPolicy;
+	}
+	board->keepSolution = true;
+	board->quiet = true;
+
+	const char *result = boardGenerate(board)
+	                     ? boardValidate(board)
+	                     : "boardGenerate failed";
+	boardFree(board);
+	return result;
+}
+
+const char* checkMinimise(CheckCase *check)
+{
+	const char *result = checkCase(check);
+	if (!result)
+		return NULL;
+
+	// halving first, then a cell at a time, until no cut fails any more
+	bool smaller = true;
+	while (smaller)
+	{
+		smaller = false;
+		CheckCase cuts[] = {
+			{check->width / 2, check->height, check->seed, check->variant},
+			{check->width, check->height / 2, check->seed, check->variant},
+			{check->width - 1, check->height, check->seed, check->variant},
+			{check->width, check->height - 1, check->seed, check->variant}
+		};
+		for (u32 i = 0; i < sizeof(cuts) / sizeof(cuts[0]) && !smaller; i++)
+		{
+			// no board is narrower than three cells
+			if (cuts[i].width < 3 || cuts[i].height < 3)
+				continue;
+			const char *cut = checkCase(&cuts[i]);
+			if (cut)
+			{
+				*check = cuts[i];
+				result = cut;
+				smaller = true;
+			}
+		}
+	}
+
+	CheckCase plain = *check;
+	plain.variant = 0;
+	const char *failure = check->variant != 0 ? checkCase(&plain) : NULL;
+	if (failure)
+	{
+		*check = plain;
+		result = failure;
+	}
+	return result;
+}
+
+// the index-th case of the run, the same for every thread count
+static CheckCase checkDraw(CheckQueue *queue, i32 index)
+{
+	u64 state = queue->seed + (u64)index;
+	u64 random = splitMix64(&state);
+	i32 sizes = queue->maxSize - queue->minSize + 1;
+	return (CheckCase){
+		.width = queue->minSize + (i32)(random % sizes),
+		.height = queue->minSize + (i32)(random / sizes % sizes),
+		// boardGenerate would pick a random seed for 0
+		.seed = splitMix64(&state) | 1,
+		.variant = (i32)(splitMix64(&state) % CHECK_NUM_VARIANTS)
+	};
+}
+
+static i32 checkWorker(void *data)
+{
+	CheckQueue *queue = data;
+	for (;;)
+	{
+		i32 index = SDL_AtomicAdd(&queue->next, 1);
+		if (index >= queue->count)
+			break;
+
+		CheckCase check = checkDraw(queue, index);
+		if (checkCase(&check))
+		{
+			SDL_AtomicLock(&queue->lock);
+			if (queue->numFailed < CHECK_MAX_REPORTED)
+				queue->failed[queue->numFailed] = check;
+			queue->numFailed += 1;
+			SDL_AtomicUnlock(&queue->lock);
+		}
+	}
+	return 0;
+}
+
+static void checkReport(CheckCase *check, const char *failure)
+{
+	printf("FAILED --case %i %i %llu %i: %s\n", check->width, check->height,
+	       (unsigned long long)check->seed, check->variant, failure);
+}
+
+// --case width height seed variant
+static i32 checkOne(i32 argc, char *argv[])
+{
+	if (argc != 4)
+	{
+		fprintf(stderr, "Usage: flow --check --case width height seed "
+		        "variant\n");
+		return 1;
+	}
+	CheckCase check = {
+		.width = atoi(argv[0]),
+		.height = atoi(argv[1]),
+		.seed = strtoull(argv[2], NULL, 10),
+		.variant = atoi(argv[3])
+	};
+	if (   check.width < 3 || check.width > CHECK_MAX_SIZE
+	    || check.height < 3 || check.height > CHECK_MAX_SIZE
+	    || check.seed == 0
+	    || check.variant < 0 || check.variant >= CHECK_NUM_VARIANTS)
+	{
+		fprintf(stderr, "Not a case: sizes from 3 to %i, a seed other "
+		        "than 0 and a variant below %i\n",
+		        CHECK_MAX_SIZE, CHECK_NUM_VARIANTS);
+		return 1;
+	}
+
+	const char *failure = checkCase(&check);
+	if (failure)
+	{
+		checkReport(&check, failure);
+		return 1;
+	}
+	printf("ok\n");
+	return 0;
+}
+
+i32 checkMain(i32 argc, char *argv[])
+{
+	if (argc > 0 && strcmp(argv[0], "--case") == 0)
+		return checkOne(argc - 1, argv + 1);
+
+	CheckQueue queue = {
+		.seed = 1,
+		.count = CHECK_DEFAULT_COUNT,
+		.minSize = CHECK_DEFAULT_MIN_SIZE,
+		.maxSize = CHECK_DEFAULT_MAX_SIZE
+	};
+	i32 numWorkers = SDL_GetCPUCount();
+	i32 numPositional = 0;
+
+	for (i32 i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			numWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc)
+			queue.minSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+			queue.maxSize = atoi(argv[++i]);
+		else if (numPositional++ == 0)
+			queue.count = atoi(argv[i]);
+		else
+			queue.seed = strtoull(argv[i], NULL, 10);
+	}
+	if (   numPositional > 2 || queue.count < 1
+	    || queue.minSize < 3 || queue.maxSize > CHECK_MAX_SIZE
+	    || queue.minSize > queue.maxSize)
+	{
+		fprintf(stderr, "Usage: flow --check [--threads n] [--min n] "
+		        "[--max n] [count] [seed]\n");
+		return 1;
+	}
+	if (numWorkers < 1)
+		numWorkers = 1;
+	if (numWorkers > queue.count)
+		numWorkers = queue.count;
+	SDL_AtomicSet(&queue.next, 0);
+
+	// the calling thread is worker 0
+	u64 startTime = SDL_GetPerformanceCounter();
+	SDL_Thread **threads = memAlloc(sizeof(SDL_Thread*) * numWorkers);
+	for (i32 i = 1; i < numWorkers; i++)
+	{
+		threads[i] = SDL_CreateThread(checkWorker, "check", &queue);
+	}
+	checkWorker(&queue);
+	for (i32 i = 1; i < numWorkers; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+	}
+	f64 seconds = (SDL_GetPerformanceCounter() - startTime)
+	              / (f64)SDL_GetPerformanceFrequency();
+	memFree(threads);
+
+	fprintf(stderr, "Checked %i boards from %ix%i to %ix%i in %.2fs on %i "
+	        "threads (%.0f boards/s): %i failed\n",
+	        queue.count, queue.minSize, queue.minSize, queue.maxSize,
+	        queue.maxSize, seconds, numWorkers, queue.count / seconds,
+	        queue.numFailed);
+
+	i32 reported = queue.numFailed < CHECK_MAX_REPORTED
+	               ? queue.numFailed
+	               : CHECK_MAX_REPORTED;
+	for (i32 i = 0; i < reported; i++)
+	{
+		CheckCase *check = &queue.failed[i];
+		const char *failure = checkMinimise(check);
+		if (failure)
+			checkReport(check, failure);
+		else
+			fprintf(stderr, "A failing case passed when run again\n");
+	}
+	return queue.numFailed > 0 ? 1 : 0;
+}
+
+#ifdef FLOW_FUZZ
+
+// libFuzzer entry, see CHECK_FUZZ_INPUT for what the bytes are. A failing
+// case aborts, so the fuzzer keeps the input that found it.
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (size < CHECK_FUZZ_INPUT)
+		return 0;
+
+	CheckCase check = {
+		.width = 3 + data[0] % (CHECK_FUZZ_MAX_SIZE - 2),
+		.height = 3 + data[1] % (CHECK_FUZZ_MAX_SIZE - 2),
+		.variant = data[2] % CHECK_NUM_VARIANTS
+	};
+	for (i32 i = 0; i < 8; i++)
+		check.seed |= (u64)data[3 + i] << (8 * i);
+	if (check.seed == 0)
+		check.seed = 1;
+
+	const char *failure = checkCase(&check);
+	if (failure)
+	{
+		checkReport(&check, failure);
+		abort();
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "common.h"
+#include "board.h"
+
+#define CHECK_DEFAULT_COUNT 100000
+#define CHECK_DEFAULT_MIN_SIZE 3
+#define CHECK_DEFAULT_MAX_SIZE 20
+
+// generator settings a case may run with, see checkConfig
+#define CHECK_NUM_VARIANTS 24
+
+// Without restarts or an ordering heuristic a single board can take
+// seconds, so like in the benchmark those settings only run on boards up
+// to this size; bigger ones go back to the default for them.
+#define CHECK_SLOW_MAX_SIZE 7
+
+// failing cases minimised and reported, the rest are only counted
+#define CHECK_MAX_REPORTED 16
+
+// One board to check: its size, its seed and which generator settings.
+typedef struct
+{
+	i32 width;
+	i32 height;
+	u64 seed;
+	i32 variant;
+} CheckCase;
+
+// variant 0 is boardDefaultGenConfig, the others every combination of
+// move order, start order, restart policy and transposition table,
+// see CHECK_SLOW_MAX_SIZE
+GenConfig checkConfig(i32 variant);
+
+// Generates the case's board solved and quietly and runs boardValidate
+// on it. NULL when it holds, otherwise what is wrong.
+const char* checkCase(CheckCase *check);
+
+// The smallest board, and default settings if those fail too, that still
+// fails the way check does, found by cutting width and height down one
+// side at a time with the same seed. Returns the failure it keeps.
+const char* checkMinimise(CheckCase *check);
+
+// Generator property checker, run as:
+//   flow --check [--threads n] [--min n] [--max n] [count] [seed]
+//   flow --check --case width height seed variant
+// Checks count boards (CHECK_DEFAULT_COUNT) with widths and heights from
+// min to max, seeds and variants all drawn from seed (1 by default), on
+// every core. Failing cases are minimised and printed as --case arguments
+// that run just that one. Built with FLOW_FUZZ, check.c instead has a
+// libFuzzer entry that reads a case from the fuzzer's bytes.
+i32 checkMain(i32 argc, char *argv[]);
+
+#endif
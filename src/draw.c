@@ -0,0 +1,114 @@
+#include <SDL2/SDL.h>
+
+#include "draw.h"
+
+SDL_Rect drawBoardView(i32 width, i32 height)
+{
+	return (SDL_Rect){
+		(width - (width * DRAW_BOARD_SCALE)) / 2,
+		(height - (height * DRAW_BOARD_SCALE)) / 2,
+		width * DRAW_BOARD_SCALE,
+		height * DRAW_BOARD_SCALE
+	};
+}
+
+void drawGlyph(SDL_Renderer *renderer, SDL_Rect *cellDim, Glyph glyph,
+               SDL_Color color)
+{
+	i32 luma = (color.r * 299 + color.g * 587 + color.b * 114) / 1000;
+	u8 shade = luma > 128 ? 0 : 255;
+	SDL_SetRenderDrawColor(renderer, shade, shade, shade, 255);
+
+	i32 cx = cellDim->x + cellDim->w / 2;
+	i32 cy = cellDim->y + cellDim->h / 2;
+	i32 rx = cellDim->w / 6 > 1 ? cellDim->w / 6 : 1;
+	i32 ry = cellDim->h / 6 > 1 ? cellDim->h / 6 : 1;
+	i32 tx = rx / 3 > 0 ? rx / 3 : 1;
+	i32 ty = ry / 3 > 0 ? ry / 3 : 1;
+
+	SDL_Rect parts[2];
+	i32 numParts = 0;
+	switch (glyph)
+	{
+		case GLYPH_DOT:
+			parts[numParts++] = (SDL_Rect){cx - tx, cy - ty, tx * 2, ty * 2};
+			break;
+		case GLYPH_HBAR:
+			parts[numParts++] = (SDL_Rect){cx - rx, cy - ty, rx * 2, ty * 2};
+			break;
+		case GLYPH_VBAR:
+			parts[numParts++] = (SDL_Rect){cx - tx, cy - ry, tx * 2, ry * 2};
+			break;
+		case GLYPH_CROSS:
+			parts[numParts++] = (SDL_Rect){cx - rx, cy - ty, rx * 2, ty * 2};
+			parts[numParts++] = (SDL_Rect){cx - tx, cy - ry, tx * 2, ry * 2};
+			break;
+		case GLYPH_RING:
+		{
+			SDL_Rect ring = {cx - rx, cy - ry, rx * 2, ry * 2};
+			SDL_RenderDrawRect(renderer, &ring);
+			break;
+		}
+		default:
+		case GLYPH_NONE:
+			break;
+	}
+	SDL_RenderFillRects(renderer, parts, numParts);
+}
+
+bool drawBoard(SDL_Renderer *renderer, const Cell *cells, i32 width,
+               i32 height, const Camera *camera, CellTexture *cellTexture,
+               PipeMesh *mesh, Palette *palette, bool glyphs)
+{
+	SDL_SetRenderDrawColor(renderer, 25, 25, 25, 255);
+	SDL_RenderFillRect(renderer, &camera->view);
+	SDL_RenderSetClipRect(renderer, &camera->view);
+
+	// zoomed out too far for cells to be drawn one by one, the board is a
+	// texel a cell, scaled up
+	if (!cameraIsDetailed(camera) && cellTexture->texture)
+	{
+		cellTextureUpdate(cellTexture, cells, width + 2, palette);
+
+		SDL_Rect dest = cameraBoardRect(camera);
+		SDL_RenderCopy(renderer, cellTexture->texture, NULL, &dest);
+		return false;
+	}
+
+	// only the cells in view
+	SDL_Rect visible = cameraVisibleCells(camera);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	for (i32 r = visible.y; r < visible.y + visible.h; r++)
+	{
+		for (i32 c = visible.x; c < visible.x + visible.w; c++)
+		{
+			SDL_Rect cell = cameraCellRect(camera, r, c);
+			SDL_Rect cellBg = {
+				cell.x + (0.1 * cell.w),
+				cell.y + (0.1 * cell.h),
+				cell.w - (0.2 * cell.w),
+				cell.h - (0.2 * cell.h)
+			};
+			SDL_RenderFillRect(renderer, &cellBg);
+		}
+	}
+
+	// the pipes in view in one batch, the clip rect trims their edges
+	pipeMeshDraw(mesh, renderer, cells, width, height, camera, palette);
+
+	for (i32 r = visible.y; r < visible.y + visible.h && glyphs; r++)
+	{
+		const Cell *cell = &cells[(r + 1) * (width + 2) + visible.x + 1];
+		for (i32 c = visible.x; c < visible.x + visible.w; c++, cell++)
+		{
+			if (   cell->state == CELLSTATE_PIPE_START
+			    || cell->state == CELLSTATE_PIPE_END)
+			{
+				SDL_Rect dest = cameraCellRect(camera, r, c);
+				SDL_Color color = paletteColor(palette, cell->color);
+				drawGlyph(renderer, &dest, paletteGlyph(cell->color), color);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,33 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+#include "camera.h"
+#include "palette.h"
+#include "pipemesh.h"
+
+// the share of the window the board is fitted into, centered
+#define DRAW_BOARD_SCALE 0.8
+
+// the rect of a width x height window the board is drawn in
+SDL_Rect drawBoardView(i32 width, i32 height);
+
+// drawn over a pipe end in black or white, whichever stands out more
+void drawGlyph(SDL_Renderer *renderer, SDL_Rect *cellDim, Glyph glyph,
+               SDL_Color color);
+
+// The board as the play state shows it, for the game and for anything
+// that draws boards without it. Fills the camera's view and clips to it,
+// then draws the cells in view, their pipes and, with glyphs, the marks on
+// the pipe ends; zoomed out past CAMERA_LOD_CELL_SIZE it draws cellTexture
+// instead. cells are padded like Board cells. Returns whether the cells
+// were drawn one by one, so there is something to draw over. The clip
+// rect is left on the view.
+bool drawBoard(SDL_Renderer *renderer, const Cell *cells, i32 width,
+               i32 height, const Camera *camera, CellTexture *cellTexture,
+               PipeMesh *mesh, Palette *palette, bool glyphs);
+
+#endif
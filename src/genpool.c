@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "genpool.h"
+#include "mem.h"
+#include "trace.h"
+
+static i32 genPoolWorker(void *data)
+{
+	GenWorker *worker = data;
+	GenPool *pool = worker->pool;
+	traceThreadName("boardGenThread");
+
+	SDL_LockMutex(pool->lock);
+	for (;;)
+	{
+		while (!pool->head && !pool->quitting)
+		{
+			SDL_CondWait(pool->wake, pool->lock);
+		}
+		if (pool->quitting)
+			break;
+
+		GenJob *job = pool->head;
+		pool->head = job->next;
+		if (!pool->head)
+			pool->tail = NULL;
+		worker->job = job;
+		SDL_AtomicSet(&job->status, GENJOB_RUNNING);
+		SDL_UnlockMutex(pool->lock);
+
+		bool result = boardGenerate(job->board);
+
+		SDL_LockMutex(pool->lock);
+		worker->job = NULL;
+		job->result = result;
+		SDL_AtomicSet(&job->status, GENJOB_DONE);
+		SDL_CondBroadcast(pool->finished);
+		if (pool->onDone)
+			pool->onDone(pool->onDoneData);
+	}
+	SDL_UnlockMutex(pool->lock);
+	traceThreadExit();
+	return 0;
+}
+
+bool genPoolInit(GenPool *pool, i32 numWorkers)
+{
+	if (numWorkers <= 0)
+		numWorkers = SDL_GetCPUCount();
+
+	pool->head = NULL;
+	pool->tail = NULL;
+	pool->quitting = false;
+	pool->onDone = NULL;
+	pool->onDoneData = NULL;
+	pool->lock = SDL_CreateMutex();
+	pool->wake = SDL_CreateCond();
+	pool->finished = SDL_CreateCond();
+	pool->workers = memCalloc(numWorkers, sizeof(GenWorker));
+	pool->numWorkers = 0;
+	if (!pool->lock || !pool->wake || !pool->finished || !pool->workers)
+	{
+		fprintf(stderr, "Failed to create the generator pool: %s\n",
+		        SDL_GetError());
+		genPoolQuit(pool);
+		return false;
+	}
+
+	for (i32 i = 0; i < numWorkers; i++)
+	{
+		GenWorker *worker = &pool->workers[pool->numWorkers];
+		worker->pool = pool;
+		worker->job = NULL;
+		worker->thread = SDL_CreateThread(genPoolWorker, "boardGenThread",
+		                                  worker);
+		if (!worker->thread)
+		{
+			fprintf(stderr, "Failed to start a generator thread: %s\n",
+			        SDL_GetError());
+			break;
+		}
+		pool->numWorkers += 1;
+	}
+
+	if (pool->numWorkers == 0)
+	{
+		genPoolQuit(pool);
+		return false;
+	}
+	return true;
+}
+
+void genPoolQuit(GenPool *pool)
+{
+	if (pool->lock)
+	{
+		SDL_LockMutex(pool->lock);
+		pool->quitting = true;
+		for (GenJob *job = pool->head; job; job = job->next)
+		{
+			job->board->genState = GENSTATE_IDLE;
+			SDL_AtomicSet(&job->status, GENJOB_CANCELLED);
+		}
+		pool->head = NULL;
+		pool->tail = NULL;
+		for (i32 i = 0; i < pool->numWorkers; i++)
+		{
+			if (pool->workers[i].job)
+				pool->workers[i].job->board->genState = GENSTATE_STOPREQUESTED;
+		}
+		SDL_CondBroadcast(pool->wake);
+		SDL_CondBroadcast(pool->finished);
+		SDL_UnlockMutex(pool->lock);
+	}
+
+	for (i32 i = 0; i < pool->numWorkers; i++)
+	{
+		SDL_WaitThread(pool->workers[i].thread, NULL);
+	}
+
+	memFree(pool->workers);
+	SDL_DestroyCond(pool->finished);
+	SDL_DestroyCond(pool->wake);
+	SDL_DestroyMutex(pool->lock);
+	*pool = (GenPool){0};
+}
+
+GenJob* genPoolSubmit(GenPool *pool, Board *board)
+{
+	GenJob *job = memAlloc(sizeof(GenJob));
+	if (!job)
+		return NULL;
+
+	job->board = board;
+	job->result = false;
+	job->next = NULL;
+	SDL_AtomicSet(&job->status, GENJOB_QUEUED);
+
+	// the board counts as generating from here on, so nothing mistakes a
+	// queued board for a finished one
+	board->genState = GENSTATE_GENERATING;
+
+	SDL_LockMutex(pool->lock);
+	if (pool->tail)
+		pool->tail->next = job;
+	else
+		pool->head = job;
+	pool->tail = job;
+	SDL_CondSignal(pool->wake);
+	SDL_UnlockMutex(pool->lock);
+	return job;
+}
+
+bool genJobDone(GenJob *job)
+{
+	i32 status = SDL_AtomicGet(&job->status);
+	return status == GENJOB_DONE || status == GENJOB_CANCELLED;
+}
+
+bool genJobWait(GenPool *pool, GenJob *job)
+{
+	SDL_LockMutex(pool->lock);
+	while (!genJobDone(job))
+	{
+		SDL_CondWait(pool->finished, pool->lock);
+	}
+	SDL_UnlockMutex(pool->lock);
+	return job->result;
+}
+
+void genJobCancel(GenPool *pool, GenJob *job)
+{
+	SDL_LockMutex(pool->lock);
+	if (SDL_AtomicGet(&job->status) == GENJOB_QUEUED)
+	{
+		GenJob **link = &pool->head;
+		GenJob *prev = NULL;
+		while (*link && *link != job)
+		{
+			prev = *link;
+			link = &(*link)->next;
+		}
+		if (*link)
+		{
+			*link = job->next;
+			if (pool->tail == job)
+				pool->tail = prev;
+		}
+		job->board->genState = GENSTATE_IDLE;
+		SDL_AtomicSet(&job->status, GENJOB_CANCELLED);
+	}
+	else if (SDL_AtomicGet(&job->status) == GENJOB_RUNNING)
+	{
+		// this also ends a pause, the search checks for it first
+		job->board->genState = GENSTATE_STOPREQUESTED;
+	}
+
+	while (!genJobDone(job))
+	{
+		SDL_CondWait(pool->finished, pool->lock);
+	}
+	SDL_UnlockMutex(pool->lock);
+}
+
+void genJobFree(GenJob *job)
+{
+	memFree(job);
+}
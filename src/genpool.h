@@ -0,0 +1,75 @@
+#ifndef GENPOOL_H
+#define GENPOOL_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+
+typedef enum
+{
+	GENJOB_QUEUED,
+	GENJOB_RUNNING,
+	GENJOB_DONE,
+	GENJOB_CANCELLED
+} GenJobStatus;
+
+// One boardGenerate call handed to the pool, and the future of its result.
+// The board belongs to the pool until the job is done or cancelled.
+typedef struct GenJob
+{
+	Board *board;
+	SDL_atomic_t status;
+	bool result;
+	struct GenJob *next;
+} GenJob;
+
+typedef struct GenWorker
+{
+	struct GenPool *pool;
+	SDL_Thread *thread;
+	// the job this worker is running, guarded by the pool lock
+	GenJob *job;
+} GenWorker;
+
+// Threads that stay around for the whole game and run generation jobs in
+// the order they are submitted.
+typedef struct GenPool
+{
+	GenWorker *workers;
+	i32 numWorkers;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_cond *finished;
+	GenJob *head;
+	GenJob *tail;
+	bool quitting;
+
+	// called on the worker, with the pool lock held, every time a job is
+	// done; set before the first job is submitted
+	void (*onDone)(void *data);
+	void *onDoneData;
+} GenPool;
+
+// numWorkers 0 starts one worker per core
+bool genPoolInit(GenPool *pool, i32 numWorkers);
+
+// cancels every job and joins the workers
+void genPoolQuit(GenPool *pool);
+
+GenJob* genPoolSubmit(GenPool *pool, Board *board);
+
+// whether the job has finished, one way or the other; never blocks
+bool genJobDone(GenJob *job);
+
+// blocks until the job has finished and returns what boardGenerate did
+bool genJobWait(GenPool *pool, GenJob *job);
+
+// Takes the job off the queue, or stops it and waits for boardGenerate to
+// return. Afterwards nothing touches the board any more.
+void genJobCancel(GenPool *pool, GenJob *job);
+
+// only once genJobDone, genJobWait or genJobCancel said it is finished
+void genJobFree(GenJob *job);
+
+#endif
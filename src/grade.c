@@ -0,0 +1,500 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <SDL2/SDL.h>
+
+#include "grade.h"
+#include "mem.h"
+#include "board.h"
+#include "solver.h"
+
+#define GRADE_MAX_LINE 4096
+
+// seed list entries asking for a bigger board are reported as invalid
+#define GRADE_MAX_SIZE 1024
+
+typedef struct
+{
+	const char *file;
+	i32 line;
+	i32 width;
+	i32 height;
+	// seed list entries have no board until a worker generates it
+	bool fromSeed;
+	u64 seed;
+	Board *board;
+
+	bool valid;
+	i32 numColors;
+	SolveStats stats;
+	f64 score;
+} GradeItem;
+
+typedef struct
+{
+	GradeItem *items;
+	i32 count;
+	i32 capacity;
+} GradeList;
+
+// One worker's share of the items, [next, end). The owner takes items
+// from the front; a worker whose own range has run dry steals the back
+// half of someone else's.
+typedef struct
+{
+	SDL_SpinLock lock;
+	i32 next;
+	i32 end;
+} GradeRange;
+
+typedef struct
+{
+	GradeItem *items;
+	GradeRange *ranges;
+	i32 numWorkers;
+	u64 maxNodes;
+	SDL_atomic_t steals;
+} GradeQueue;
+
+typedef struct
+{
+	GradeQueue *queue;
+	i32 index;
+} GradeWorker;
+
+static GradeItem* gradeAdd(GradeList *list, const char *file, i32 line)
+{
+	if (list->count == list->capacity)
+	{
+		list->capacity = list->capacity ? list->capacity * 2 : 256;
+		list->items = memRealloc(list->items, sizeof(GradeItem) * list->capacity);
+	}
+	GradeItem *item = &list->items[list->count++];
+	*item = (GradeItem){.file = file, .line = line};
+	return item;
+}
+
+// Splits a line into numbers, -1 for "_". Returns how many, or -1 if
+// the line holds anything else.
+static i32 gradeTokens(const char *line, i64 *tokens, i32 maxTokens)
+{
+	i32 count = 0;
+	const char *s = line;
+	for (;;)
+	{
+		while (isspace((unsigned char)*s))
+			s++;
+		if (*s == '\0')
+			return count;
+		if (count == maxTokens)
+			return -1;
+
+		if (*s == '_')
+		{
+			tokens[count++] = -1;
+			s++;
+		}
+		else if (isdigit((unsigned char)*s))
+		{
+			char *end;
+			u64 value = strtoull(s, &end, 10);
+			tokens[count++] = value > INT64_MAX ? INT64_MAX : (i64)value;
+			s = end;
+		}
+		else
+		{
+			return -1;
+		}
+
+		if (*s != '\0' && !isspace((unsigned char)*s))
+			return -1;
+	}
+}
+
+// Turns the rows read so far into a board. Colors are renumbered from 0
+// in reading order; the first cell of a color is its start.
+static bool gradeFinishBoard(GradeItem *item, i64 *cells, i32 width,
+                             i32 height)
+{
+	i32 size = width * height;
+	i64 *colors = memAlloc(sizeof(i64) * size);
+	i32 *seen = memAlloc(sizeof(i32) * size);
+	i32 numColors = 0;
+	bool valid = true;
+
+	Board *board = boardCreate(width, height);
+	for (i32 i = 0; i < size && valid; i++)
+	{
+		if (cells[i] < 0)
+			continue;
+
+		i32 color = 0;
+		while (color < numColors && colors[color] != cells[i])
+			color++;
+		if (color == numColors)
+		{
+			colors[numColors] = cells[i];
+			seen[numColors] = 0;
+			numColors += 1;
+		}
+		seen[color] += 1;
+
+		Cell *cell = boardGet(board, i / width, i % width);
+		cell->color = color;
+		if (seen[color] == 1)
+			cell->state = CELLSTATE_PIPE_START;
+		else if (seen[color] == 2)
+			cell->state = CELLSTATE_PIPE_END;
+		else
+			valid = false;
+	}
+	board->numColors = numColors;
+	if (!valid)
+	{
+		boardFree(board);
+		board = NULL;
+	}
+
+	memFree(seen);
+	memFree(colors);
+	item->width = width;
+	item->height = height;
+	item->board = board;
+	return valid;
+}
+
+static bool gradeReadFile(GradeList *list, const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return false;
+	}
+
+	char line[GRADE_MAX_LINE];
+	i32 lineNumber = 0;
+	i64 *row = memAlloc(sizeof(i64) * GRADE_MAX_LINE);
+	i64 *cells = NULL;
+	i32 width = 0;
+	i32 height = 0;
+	i32 capacity = 0;
+	i32 boardLine = 0;
+	bool ok = true;
+
+	for (;;)
+	{
+		bool more = fgets(line, sizeof(line), file) != NULL;
+		lineNumber += 1;
+
+		i32 count = more ? gradeTokens(line, row, GRADE_MAX_LINE) : 0;
+		if (count < 0)
+		{
+			fprintf(stderr, "%s:%i: not a board row or a seed\n",
+			        path, lineNumber);
+			ok = false;
+			break;
+		}
+
+		// a blank line or the end of the file closes a board
+		if (count == 0 && height > 0)
+		{
+			GradeItem *item = gradeAdd(list, path, boardLine);
+			if (!gradeFinishBoard(item, cells, width, height))
+			{
+				fprintf(stderr, "%s:%i: a color has more than two "
+				        "endpoints\n", path, boardLine);
+			}
+			height = 0;
+		}
+		if (!more)
+			break;
+		if (count == 0)
+			continue;
+
+		// no board is narrower than three cells
+		if (count == 2 && height == 0 && row[0] >= 0 && row[1] >= 0)
+		{
+			GradeItem *item = gradeAdd(list, path, lineNumber);
+			item->fromSeed = true;
+			item->width = row[0] > GRADE_MAX_SIZE ? 0 : (i32)row[0];
+			item->height = item->width;
+			item->seed = (u64)row[1];
+			continue;
+		}
+
+		if (height == 0)
+		{
+			width = count;
+			boardLine = lineNumber;
+		}
+		// in cells, boards of any width share the buffer
+		if ((height + 1) * width > capacity)
+		{
+			capacity = capacity ? capacity * 2 : width * width;
+			if (capacity < (height + 1) * width)
+				capacity = (height + 1) * width;
+			cells = memRealloc(cells, sizeof(i64) * capacity);
+		}
+		if (count != width)
+		{
+			fprintf(stderr, "%s:%i: rows of a board must be the same length\n",
+			        path, lineNumber);
+			ok = false;
+			break;
+		}
+		memcpy(cells + height * width, row, sizeof(i64) * width);
+		height += 1;
+	}
+
+	memFree(cells);
+	memFree(row);
+	fclose(file);
+	return ok;
+}
+
+static void gradeItem(GradeQueue *queue, GradeItem *item)
+{
+	if (item->fromSeed)
+	{
+		// boardGenerate would pick a random seed for 0
+		if (item->seed == 0 || item->width < 3)
+			return;
+		item->board = boardCreate(item->width, item->height);
+		item->board->seed = item->seed;
+		item->board->quiet = true;
+		if (!boardGenerate(item->board))
+		{
+			boardFree(item->board);
+			item->board = NULL;
+			return;
+		}
+	}
+
+	Solver solver;
+	if (item->board && solverInit(&solver, item->board))
+	{
+		item->valid = true;
+		item->numColors = solver.numPipes;
+		solverSolve(&solver, queue->maxNodes);
+		item->stats = solver.stats;
+		item->score = solverDifficulty(&solver.stats,
+		                               item->width * item->height);
+		solverFree(&solver);
+	}
+
+	// only the report is kept, so thousands of boards fit in memory
+	if (item->board)
+		boardFree(item->board);
+	item->board = NULL;
+}
+
+static i32 gradeTake(GradeRange *range)
+{
+	SDL_AtomicLock(&range->lock);
+	i32 item = range->next < range->end ? range->next++ : -1;
+	SDL_AtomicUnlock(&range->lock);
+	return item;
+}
+
+// moves the back half of another worker's range into the thief's own,
+// false once every range is empty
+static bool gradeSteal(GradeQueue *queue, i32 thief)
+{
+	for (i32 i = 1; i < queue->numWorkers; i++)
+	{
+		GradeRange *victim = &queue->ranges[(thief + i) % queue->numWorkers];
+		SDL_AtomicLock(&victim->lock);
+		i32 count = (victim->end - victim->next + 1) / 2;
+		i32 end = victim->end;
+		victim->end -= count;
+		SDL_AtomicUnlock(&victim->lock);
+
+		if (count > 0)
+		{
+			GradeRange *own = &queue->ranges[thief];
+			SDL_AtomicLock(&own->lock);
+			own->next = end - count;
+			own->end = end;
+			SDL_AtomicUnlock(&own->lock);
+			SDL_AtomicIncRef(&queue->steals);
+			return true;
+		}
+	}
+	return false;
+}
+
+static i32 gradeWorker(void *data)
+{
+	GradeWorker *worker = data;
+	GradeQueue *queue = worker->queue;
+	GradeRange *range = &queue->ranges[worker->index];
+
+	for (;;)
+	{
+		i32 index = gradeTake(range);
+		if (index >= 0)
+			gradeItem(queue, &queue->items[index]);
+		else if (!gradeSteal(queue, worker->index))
+			break;
+	}
+	return 0;
+}
+
+static const char* gradeStatus(GradeItem *item)
+{
+	if (!item->valid)
+		return "invalid";
+	return item->stats.solved ? "solved" : "unsolved";
+}
+
+static void gradeWriteCsv(FILE *file, GradeList *list)
+{
+	fprintf(file, "file,line,width,height,seed,colors,status,nodes,forced,"
+	        "branches,ms,score\n");
+	for (i32 i = 0; i < list->count; i++)
+	{
+		GradeItem *item = &list->items[i];
+		fprintf(file, "%s,%i,%i,%i,%llu,%i,%s,%llu,%llu,%llu,%.3f,%.1f\n",
+		        item->file, item->line, item->width, item->height,
+		        (unsigned long long)item->seed, item->numColors,
+		        gradeStatus(item),
+		        (unsigned long long)item->stats.nodes,
+		        (unsigned long long)item->stats.forced,
+		        (unsigned long long)item->stats.branches,
+		        item->stats.seconds * 1000.0, item->score);
+	}
+}
+
+static void gradeWriteJson(FILE *file, GradeList *list)
+{
+	fprintf(file, "[\n");
+	for (i32 i = 0; i < list->count; i++)
+	{
+		GradeItem *item = &list->items[i];
+		fprintf(file, "  {\"file\": \"");
+		for (const char *c = item->file; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', file);
+			fputc(*c, file);
+		}
+		fprintf(file, "\", \"line\": %i, \"width\": %i, \"height\": %i, "
+		        "\"seed\": %llu, \"colors\": %i, \"status\": \"%s\", "
+		        "\"nodes\": %llu, \"forced\": %llu, \"branches\": %llu, "
+		        "\"ms\": %.3f, \"score\": %.1f}%s\n",
+		        item->line, item->width, item->height,
+		        (unsigned long long)item->seed, item->numColors,
+		        gradeStatus(item),
+		        (unsigned long long)item->stats.nodes,
+		        (unsigned long long)item->stats.forced,
+		        (unsigned long long)item->stats.branches,
+		        item->stats.seconds * 1000.0, item->score,
+		        i + 1 < list->count ? "," : "");
+	}
+	fprintf(file, "]\n");
+}
+
+i32 gradeMain(i32 argc, char *argv[])
+{
+	bool json = false;
+	const char *outPath = NULL;
+	i32 numWorkers = SDL_GetCPUCount();
+	u64 maxNodes = 0;
+	GradeList list = {0};
+
+	for (i32 i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--json") == 0)
+			json = true;
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			outPath = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			numWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc)
+			maxNodes = strtoull(argv[++i], NULL, 10);
+		else if (!gradeReadFile(&list, argv[i]))
+			return 1;
+	}
+	if (!outPath)
+		outPath = json ? GRADE_JSON_PATH : GRADE_CSV_PATH;
+	if (list.count == 0)
+	{
+		fprintf(stderr, "Nothing to grade\n");
+		return 1;
+	}
+	if (numWorkers < 1)
+		numWorkers = 1;
+	if (numWorkers > list.count)
+		numWorkers = list.count;
+
+	GradeQueue queue = {
+		.items = list.items,
+		.ranges = memCalloc(numWorkers, sizeof(GradeRange)),
+		.numWorkers = numWorkers,
+		.maxNodes = maxNodes
+	};
+	SDL_AtomicSet(&queue.steals, 0);
+	GradeWorker *workers = memAlloc(sizeof(GradeWorker) * numWorkers);
+	for (i32 i = 0; i < numWorkers; i++)
+	{
+		queue.ranges[i].next = (i64)list.count * i / numWorkers;
+		queue.ranges[i].end = (i64)list.count * (i + 1) / numWorkers;
+		workers[i] = (GradeWorker){.queue = &queue, .index = i};
+	}
+
+	// the calling thread is worker 0
+	u64 startTime = SDL_GetPerformanceCounter();
+	SDL_Thread **threads = memAlloc(sizeof(SDL_Thread*) * numWorkers);
+	for (i32 i = 1; i < numWorkers; i++)
+	{
+		threads[i] = SDL_CreateThread(gradeWorker, "grade", &workers[i]);
+	}
+	gradeWorker(&workers[0]);
+	for (i32 i = 1; i < numWorkers; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+	}
+	f64 seconds = (SDL_GetPerformanceCounter() - startTime)
+	              / (f64)SDL_GetPerformanceFrequency();
+
+	i32 unsolved = 0;
+	i32 invalid = 0;
+	for (i32 i = 0; i < list.count; i++)
+	{
+		if (!list.items[i].valid)
+			invalid += 1;
+		else if (!list.items[i].stats.solved)
+			unsolved += 1;
+	}
+
+	i32 result = 0;
+	FILE *file = fopen(outPath, "w");
+	if (file)
+	{
+		if (json)
+			gradeWriteJson(file, &list);
+		else
+			gradeWriteCsv(file, &list);
+		fclose(file);
+	}
+	else
+	{
+		fprintf(stderr, "Failed to open %s for writing\n", outPath);
+		result = 1;
+	}
+
+	fprintf(stderr, "Graded %i boards in %.2fs on %i threads "
+	        "(%.0f boards/min, %i steals): %i unsolved, %i invalid, "
+	        "report in %s\n",
+	        list.count, seconds, numWorkers, list.count / seconds * 60.0,
+	        SDL_AtomicGet(&queue.steals), unsolved, invalid, outPath);
+
+	memFree(threads);
+	memFree(workers);
+	memFree(queue.ranges);
+	memFree(list.items);
+	return result;
+}
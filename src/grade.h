@@ -0,0 +1,19 @@
+#ifndef GRADE_H
+#define GRADE_H
+
+#include "common.h"
+
+#define GRADE_CSV_PATH "grades.csv"
+#define GRADE_JSON_PATH "grades.json"
+
+// Headless puzzle grader, run as:
+//   flow --grade [--json] [--out path] [--threads n] [--max-nodes n] file...
+// Every file is read line by line. A line of two numbers is a seed list
+// entry, "size seed", for the board boardGenerate makes from that seed.
+// Anything else is a board row in the format of boardPrint: one token per
+// cell, "_" for an empty one and a color for an endpoint, with boards
+// separated by a blank line. Every board is solved from its endpoints and
+// the report goes to --out, by default GRADE_CSV_PATH or GRADE_JSON_PATH.
+i32 gradeMain(i32 argc, char *argv[]);
+
+#endif
@@ -0,0 +1,320 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "hint.h"
+
+// what hintUpdate found out about the player's pipes
+typedef enum
+{
+	HINTUPDATE_AGREES,
+	HINTUPDATE_WRONG,
+	HINTUPDATE_UNKNOWN
+} HintUpdate;
+
+// Reads the pipe the player has drawn for pipe into path, from the
+// endpoint it was started at. Returns how many cells it has, 0 if there
+// is nothing past the endpoint.
+static i32 hintPlayerPath(Hint *hint, i32 pipe, i32 *path)
+{
+	Board *board = hint->board;
+	Solver *solver = &hint->solver;
+	i32 first = solver->start[pipe];
+	i32 last = solver->target[pipe];
+	if (board->cells[first].connection == CELLCONNECTION_NONE)
+	{
+		first = solver->target[pipe];
+		last = solver->start[pipe];
+	}
+
+	i32 cell = first;
+	i32 count = 0;
+	i32 limit = board->width * board->height;
+	path[count++] = cell;
+	while (   board->cells[cell].connection != CELLCONNECTION_NONE
+	       && count < limit)
+	{
+		cell += board->delta[board->cells[cell].connection];
+		Cell *next = &board->cells[cell];
+		bool drawn = next->state == CELLSTATE_PIPE || cell == last;
+		if (!drawn || next->color != pipe)
+			break;
+
+		path[count++] = cell;
+		if (cell == last)
+			break;
+	}
+	return count > 1 ? count : 0;
+}
+
+// whether the solution goes the way of the count cells of path
+static bool hintAgrees(Hint *hint, i32 pipe, const i32 *path, i32 count)
+{
+	const i32 *step = path[0] == hint->solver.start[pipe]
+	                  ? hint->next
+	                  : hint->prev;
+	for (i32 i = 1; i < count; i++)
+	{
+		if (step[path[i - 1]] != path[i])
+			return false;
+	}
+	return true;
+}
+
+// Searches from the player's pipes, or from the endpoints alone, and
+// keeps what it finds in next and prev.
+static bool hintSolve(Hint *hint, u64 maxNodes, bool fromPlayer)
+{
+	Solver *solver = &hint->solver;
+	solverReset(solver);
+	if (fromPlayer)
+	{
+		for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+		{
+			i32 count = hintPlayerPath(hint, pipe, hint->path);
+			if (count > 0 && !solverFixPath(solver, pipe, hint->path, count))
+			{
+				solverReset(solver);
+				return false;
+			}
+		}
+	}
+
+	bool solved = solverSolve(solver, maxNodes);
+	if (solved)
+	{
+		memset(hint->next, 0xff, sizeof(i32) * solver->numCells);
+		memset(hint->prev, 0xff, sizeof(i32) * solver->numCells);
+
+		// every move is a step along its pipe, the wrong way round for the
+		// pipes the player drew from their PIPE_END end
+		for (i32 i = 0; i < solver->numMoves; i++)
+		{
+			SolverMove *move = &solver->moves[i];
+			i32 from = move->previousHead;
+			i32 to = move->cell;
+			if (solver->target[move->pipe] == solver->start[move->pipe])
+			{
+				from = move->cell;
+				to = move->previousHead;
+			}
+			hint->next[from] = to;
+			hint->prev[to] = from;
+		}
+	}
+	solverReset(solver);
+	return solved;
+}
+
+bool hintInit(Hint *hint, Board *board, u64 maxNodes)
+{
+	*hint = (Hint){.board = board, .failedKey = 0};
+	if (!solverInit(&hint->solver, board))
+		return false;
+
+	i32 padded = board->numCells;
+	i32 numPipes = hint->solver.numPipes;
+	size_t arenaSize = sizeof(i32) * padded * 5
+	                   + (sizeof(bool) + sizeof(i32)) * numPipes
+	                   + 16 * 8;
+	if (!arenaInit(&hint->arena, arenaSize))
+	{
+		solverFree(&hint->solver);
+		return false;
+	}
+	hint->next = arenaAlloc(&hint->arena, sizeof(i32) * padded);
+	hint->prev = arenaAlloc(&hint->arena, sizeof(i32) * padded);
+	hint->baseNext = arenaAlloc(&hint->arena, sizeof(i32) * padded);
+	hint->basePrev = arenaAlloc(&hint->arena, sizeof(i32) * padded);
+	hint->path = arenaAlloc(&hint->arena, sizeof(i32) * padded);
+	hint->finished = arenaAlloc(&hint->arena, sizeof(bool) * numPipes);
+	hint->revealed = arenaAlloc(&hint->arena, sizeof(i32) * numPipes);
+	memset(hint->revealed, 0, sizeof(i32) * numPipes);
+
+	if (!hintSolve(hint, maxNodes, false))
+	{
+		hintFree(hint);
+		return false;
+	}
+	memcpy(hint->baseNext, hint->next, sizeof(i32) * padded);
+	memcpy(hint->basePrev, hint->prev, sizeof(i32) * padded);
+	return true;
+}
+
+void hintFree(Hint *hint)
+{
+	solverFree(&hint->solver);
+	arenaFree(&hint->arena);
+}
+
+// Whether every pipe the player has not finished can still reach its
+// other end past what is drawn. The search could only fail otherwise, and
+// only after trying everything its budget allows.
+static bool hintReachable(Hint *hint)
+{
+	Board *board = hint->board;
+	Solver *solver = &hint->solver;
+	for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+	{
+		if (hint->finished[pipe])
+			continue;
+
+		i32 count = hintPlayerPath(hint, pipe, hint->path);
+		i32 tip = count > 0 ? hint->path[count - 1] : solver->start[pipe];
+		i32 end = count > 0 && hint->path[0] == solver->target[pipe]
+		          ? solver->start[pipe]
+		          : solver->target[pipe];
+		if (!boardEmptyPathExists(board,
+		                          tip / board->stride - 1,
+		                          tip % board->stride - 1,
+		                          end / board->stride - 1,
+		                          end % board->stride - 1))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Makes sure next and prev agree with every pipe the player has drawn,
+// searching again only if they do not. WRONG, with the solution from the
+// endpoints in their place, if there is none that does, UNKNOWN the same
+// way if the search ran out of nodes before it could tell.
+static HintUpdate hintUpdate(Hint *hint)
+{
+	Solver *solver = &hint->solver;
+	bool agrees = true;
+	u64 key = 14695981039346656037ull;
+	for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+	{
+		i32 count = hintPlayerPath(hint, pipe, hint->path);
+		hint->finished[pipe]
+		    = count > 0 && (   hint->path[count - 1] == solver->start[pipe]
+		                    || hint->path[count - 1] == solver->target[pipe]);
+		agrees = agrees && hintAgrees(hint, pipe, hint->path, count);
+		for (i32 i = 0; i < count; i++)
+		{
+			key ^= (u64)hint->path[i];
+			key *= 1099511628211ull;
+		}
+	}
+
+	if (agrees)
+	{
+		hint->cachedHints += 1;
+		return HINTUPDATE_AGREES;
+	}
+
+	if (key != hint->failedKey)
+	{
+		// a search that never ran did not run out either
+		solver->aborted = false;
+		u64 startTime = SDL_GetPerformanceCounter();
+		bool solved = hintReachable(hint)
+		              && hintSolve(hint, HINT_MAX_NODES, true);
+		hint->lastSeconds = (SDL_GetPerformanceCounter() - startTime)
+		                    / (f64)SDL_GetPerformanceFrequency();
+		hint->solvedHints += 1;
+		if (solved)
+		{
+			// what was shown of the old solution may not be in this one
+			memset(hint->revealed, 0, sizeof(i32) * solver->numPipes);
+			hint->failedKey = 0;
+			return HINTUPDATE_AGREES;
+		}
+		hint->failedKey = key;
+		hint->failedAborted = solver->aborted;
+	}
+
+	memcpy(hint->next, hint->baseNext, sizeof(i32) * solver->numCells);
+	memcpy(hint->prev, hint->basePrev, sizeof(i32) * solver->numCells);
+	return hint->failedAborted ? HINTUPDATE_UNKNOWN : HINTUPDATE_WRONG;
+}
+
+// how many cells of the solution, from the start of pipe, are shown once
+// the stretch after the first shown ones is
+static i32 hintStretch(Hint *hint, i32 pipe, i32 shown)
+{
+	i32 cell = hint->solver.start[pipe];
+	for (i32 i = 1; i < shown; i++)
+		cell = hint->next[cell];
+
+	i32 step = hint->next[cell];
+	if (step < 0)
+		return shown;
+
+	i32 direction = step - cell;
+	do
+	{
+		cell = step;
+		shown += 1;
+		step = hint->next[cell];
+	} while (step >= 0 && step - cell == direction);
+	return shown;
+}
+
+i32 hintNext(Hint *hint, i32 preferred)
+{
+	Solver *solver = &hint->solver;
+	HintUpdate update = hintUpdate(hint);
+
+	// the player's pipes may well be right, there is just nothing to
+	// show from them; the next hint after they change searches again
+	if (update == HINTUPDATE_UNKNOWN)
+		return -1;
+
+	if (update == HINTUPDATE_WRONG)
+	{
+		// point out a pipe of the player's that the solution does not have
+		i32 wrong = -1;
+		for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+		{
+			i32 count = hintPlayerPath(hint, pipe, hint->path);
+			if (   !hintAgrees(hint, pipe, hint->path, count)
+			    && (wrong < 0 || pipe == preferred))
+			{
+				wrong = pipe;
+			}
+		}
+		if (wrong >= 0)
+		{
+			i32 length = 1;
+			for (i32 cell = solver->start[wrong];
+			     hint->next[cell] >= 0;
+			     cell = hint->next[cell])
+			{
+				length += 1;
+			}
+			memset(hint->revealed, 0, sizeof(i32) * solver->numPipes);
+			hint->revealed[wrong] = length;
+			return wrong;
+		}
+	}
+
+	i32 pipe = -1;
+	i32 pipeShown = 0;
+	for (i32 p = 0; p < solver->numPipes; p++)
+	{
+		if (hint->finished[p])
+			continue;
+
+		// what the player drew from the start shows that much already
+		i32 count = hintPlayerPath(hint, p, hint->path);
+		i32 shown = hint->revealed[p] > 1 ? hint->revealed[p] : 1;
+		if (count > shown && hint->path[0] == solver->start[p])
+			shown = count;
+		if (hintStretch(hint, p, shown) == shown)
+			continue;
+
+		if (pipe < 0 || p == preferred)
+		{
+			pipe = p;
+			pipeShown = shown;
+		}
+	}
+	if (pipe < 0)
+		return -1;
+
+	hint->revealed[pipe] = hintStretch(hint, pipe, pipeShown);
+	return pipe;
+}
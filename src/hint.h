@@ -0,0 +1,68 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "arena.h"
+#include "board.h"
+#include "solver.h"
+
+// search a hint may do when the player's pipes leave the solution it
+// has, about a millisecond on a 10x10 board
+#define HINT_MAX_NODES 400
+
+// Hints for the board being played. The solution is found once, when
+// the hint is set up, and kept: a hint only searches again when the
+// pipes the player has drawn stop agreeing with it, and then from those
+// pipes on rather than from the endpoints.
+typedef struct
+{
+	Board *board;
+	Solver solver;
+
+	// the solution hints come from, the cell after and before every cell
+	// of it along its pipe, from the PIPE_START end; -1 at the ends and
+	// where no pipe goes
+	i32 *next;
+	i32 *prev;
+
+	// the solution from the endpoints alone, for when the player's pipes
+	// have none
+	i32 *baseNext;
+	i32 *basePrev;
+
+	// cells of the pipe being read off the board
+	i32 *path;
+	bool *finished;
+
+	// cells of every pipe, from its start, that the hints have shown
+	i32 *revealed;
+
+	// the player's pipes the last search gave up on, so another hint for
+	// the same pipes does not run it again, and whether it gave up because
+	// it ran out of HINT_MAX_NODES rather than finding no solution
+	u64 failedKey;
+	bool failedAborted;
+
+	u64 cachedHints;
+	u64 solvedHints;
+	f64 lastSeconds;
+
+	Arena arena;
+} Hint;
+
+// Solves the board from its endpoints, in at most maxNodes positions or
+// as long as that takes for 0. False if it is not a puzzle or no solution
+// was found.
+bool hintInit(Hint *hint, Board *board, u64 maxNodes);
+
+void hintFree(Hint *hint);
+
+// Shows the next stretch of one pipe the player has not finished, up to
+// where it turns. preferred, the color being drawn or -1, goes first.
+// When the player's pipes have no solution the pipe shown in full is one
+// of theirs that is wrong. Returns the pipe, or -1 if there is nothing
+// left to show or the search ran out of HINT_MAX_NODES before it knew.
+i32 hintNext(Hint *hint, i32 preferred);
+
+#endif
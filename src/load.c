@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "serve.h"
+#include "mem.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+typedef struct
+{
+	i32 fd;
+	u8 request[SERVE_REQUEST_SIZE];
+	i32 requestSent;
+	u8 *response;
+	i32 responseRead;
+	i32 responseLength;
+	u64 sentAt;
+} LoadConnection;
+
+static i32 compareU64(const void *a, const void *b)
+{
+	u64 x = *(const u64*)a;
+	u64 y = *(const u64*)b;
+	return (x > y) - (x < y);
+}
+
+static f64 loadPercentile(u64 *sorted, i32 count, f64 percentile)
+{
+	i32 index = (i32)(percentile / 100.0 * (count - 1) + 0.5);
+	return sorted[index] * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static bool loadSend(LoadConnection *connection)
+{
+	while (connection->requestSent < SERVE_REQUEST_SIZE)
+	{
+		ssize_t n = write(connection->fd,
+		                  connection->request + connection->requestSent,
+		                  SERVE_REQUEST_SIZE - connection->requestSent);
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		connection->requestSent += n;
+	}
+	return true;
+}
+
+static void loadStart(LoadConnection *connection)
+{
+	connection->requestSent = 0;
+	connection->responseRead = 0;
+	connection->responseLength = SERVE_HEADER_SIZE;
+	connection->sentAt = SDL_GetPerformanceCounter();
+}
+
+// Reads what there is of the response. Returns 1 once it is complete, 0
+// while it is not and -1 when the connection is gone or the response is
+// not a board.
+static i32 loadReceive(LoadConnection *connection)
+{
+	for (;;)
+	{
+		ssize_t n = read(connection->fd,
+		                 connection->response + connection->responseRead,
+		                 connection->responseLength - connection->responseRead);
+		if (n == 0)
+			return -1;
+		if (n < 0)
+		{
+			bool again = errno == EAGAIN || errno == EWOULDBLOCK
+			             || errno == EINTR;
+			return again ? 0 : -1;
+		}
+		connection->responseRead += n;
+		if (connection->responseRead < connection->responseLength)
+			continue;
+
+		// the header says how much follows it
+		if (connection->responseLength == SERVE_HEADER_SIZE)
+		{
+			ServeHeader header;
+			serveDecodeHeader(connection->response, &header);
+			if (header.status != SERVE_OK)
+				return -1;
+			connection->responseLength += header.numColors * 8;
+			if (connection->responseLength > connection->responseRead)
+			{
+				connection->response = memRealloc(connection->response,
+				                               connection->responseLength);
+				continue;
+			}
+		}
+		return 1;
+	}
+}
+
+i32 serveLoadMain(i32 argc, char *argv[])
+{
+	const char *path   = argc > 0 ? argv[0] : SERVE_DEFAULT_PATH;
+	i32 numConnections = argc > 1 ? atoi(argv[1]) : 8;
+	i32 numRequests    = argc > 2 ? atoi(argv[2]) : 10000;
+	i32 size           = argc > 3 ? atoi(argv[3]) : 9;
+	if (numConnections < 1)
+		numConnections = 1;
+	if (numRequests < numConnections)
+		numRequests = numConnections;
+
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return 1;
+	}
+	strcpy(address.sun_path, path);
+
+	ServeRequest request = {.width = size, .height = size, .seed = 0};
+	i32 epollFd = epoll_create1(0);
+	LoadConnection *connections = memCalloc(numConnections, sizeof(LoadConnection));
+	u64 *latencies = memAlloc(sizeof(u64) * numRequests);
+	i32 numSent = 0;
+	i32 numDone = 0;
+	i32 numFailed = 0;
+	bool ok = epollFd >= 0;
+
+	u64 startTime = SDL_GetPerformanceCounter();
+	for (i32 i = 0; i < numConnections && ok; i++)
+	{
+		LoadConnection *connection = &connections[i];
+		connection->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (   connection->fd < 0
+		    || connect(connection->fd, (struct sockaddr*)&address,
+		               sizeof(address)) != 0)
+		{
+			fprintf(stderr, "Failed to connect to %s: %s\n",
+			        path, strerror(errno));
+			ok = false;
+			break;
+		}
+		fcntl(connection->fd, F_SETFL,
+		      fcntl(connection->fd, F_GETFL) | O_NONBLOCK);
+		connection->response = memAlloc(SERVE_HEADER_SIZE);
+		serveEncodeRequest(connection->request, &request);
+
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = connection};
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, connection->fd, &event);
+		loadStart(connection);
+		loadSend(connection);
+		numSent += 1;
+	}
+
+	struct epoll_event events[64];
+	while (ok && numDone + numFailed < numSent)
+	{
+		i32 count = epoll_wait(epollFd, events, 64, -1);
+		if (count < 0 && errno != EINTR)
+			break;
+
+		for (i32 i = 0; i < count; i++)
+		{
+			LoadConnection *connection = events[i].data.ptr;
+			i32 received = loadReceive(connection);
+			if (received == 0)
+				continue;
+
+			if (received < 0)
+			{
+				// the rest of this connection's share is lost with it
+				numFailed += 1;
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+				continue;
+			}
+
+			latencies[numDone++]
+			    = SDL_GetPerformanceCounter() - connection->sentAt;
+			if (numSent < numRequests)
+			{
+				loadStart(connection);
+				if (loadSend(connection))
+					numSent += 1;
+				else
+					numFailed += 1;
+			}
+		}
+	}
+	f64 seconds = (SDL_GetPerformanceCounter() - startTime)
+	              / (f64)SDL_GetPerformanceFrequency();
+
+	if (numDone > 0)
+	{
+		qsort(latencies, numDone, sizeof(u64), compareU64);
+		printf("%i requests for %ix%i boards on %i connections in %.2fs: "
+		       "%.0f req/s, %i failed\n",
+		       numDone, size, size, numConnections, seconds,
+		       numDone / seconds, numFailed);
+		printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  "
+		       "max %.3f\n",
+		       loadPercentile(latencies, numDone, 50.0),
+		       loadPercentile(latencies, numDone, 90.0),
+		       loadPercentile(latencies, numDone, 99.0),
+		       loadPercentile(latencies, numDone, 99.9),
+		       loadPercentile(latencies, numDone, 100.0));
+	}
+
+	for (i32 i = 0; i < numConnections; i++)
+	{
+		if (connections[i].fd > 0)
+			close(connections[i].fd);
+		memFree(connections[i].response);
+	}
+	memFree(latencies);
+	memFree(connections);
+	if (epollFd >= 0)
+		close(epollFd);
+	return ok && numFailed == 0 ? 0 : 1;
+}
+
+#else
+
+i32 serveLoadMain(i32 argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "The load generator needs Linux\n");
+	return 1;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 #include <time.h>
 #include <pthread.h>
@@ -6,34 +7,36 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
+#include "audio.h"
 #include "board.h"
+#include "bench.h"
+#include "camera.h"
+#include "check.h"
+#include "draw.h"
+#include "pipemesh.h"
+#include "grade.h"
+#include "hint.h"
+#include "genpool.h"
+#include "mem.h"
+#include "palette.h"
+#include "profiler.h"
+#include "save.h"
+#include "serve.h"
+#include "text.h"
+#include "thumb.h"
+#include "trace.h"
 
 #define DEFAULT_BOARD_SIZE 6
 
-const SDL_Color colorMap[CELLCOLOR_COUNT] = {
-	{255,   0,   0}, // CELLCOLOR_RED
-	{  0, 255,   0}, // CELLCOLOR_GREEN
-	{  0,   0, 255}, // CELLCOLOR_BLUE
-	{255, 255,   0}, // CELLCOLOR_YELLOW
-	{125,   0, 255}, // CELLCOLOR_PURPLE
-	{  0, 255, 255}, // CELLCOLOR_CYAN
-	{255, 255, 255}, // CELLCOLOR_WHITE
-	{211, 211, 211}, // CELLCOLOR_LIGHT_GRAY
-	{128, 128, 128}, // CELLCOLOR_MEDIUM_GRAY
-	{169, 169, 169}, // CELLCOLOR_DARK_GRAY
-	{255,   0, 255}, // CELLCOLOR_MAGENTA
-	{255, 192, 203}, // CELLCOLOR_PINK
-	{139,   0,   0}, // CELLCOLOR_DARK_RED
-	{  0, 100,   0}, // CELLCOLOR_DARK_GREEN
-	{  0,   0, 139}, // CELLCOLOR_DARK_BLUE
-	{ 50,   0,   0}, // CELLCOLOR_ULTRADARK_RED
-	{  0,  50,   0}, // CELLCOLOR_ULTRADARK_GREEN
-	{  0,   0,  50}, // CELLCOLOR_ULTRADARK_BLUE
-	{ 50,  50,   0}, // CELLCOLOR_ULTRADARK_YELLOW
-	{ 50,   0,  50}, // CELLCOLOR_ULTRADARK_PURPLE
-	{  0,  50,  50}, // CELLCOLOR_ULTRADARK_CYAN
-	{255,   0, 255}  // CELLCOLOR_FUCHSIA
-};
+// Built with FLOW_NO_THREADS (make clean && make CPPFLAGS=-DFLOW_NO_THREADS)
+// the board is generated in playLoop, at most this long every frame so the
+// game keeps up 60 fps while it runs.
+#define GENERATE_SLICE_US 8000
+
+// the one search hints on a new board may take longer than a frame for,
+// boards from LARGE_BOARD_SIZE up get no hints
+#define HINT_INIT_NODES 100000
+
 
 typedef enum Sound
 {
@@ -56,6 +59,22 @@ typedef enum GameMusic
 	GAMEMUSIC_COUNT
 } GameMusic;
 
+// files in AUDIO_DIR, see audioInit and audioPlayMusic
+static const char *soundNames[SOUND_COUNT] = {
+	"click_001",
+	"YUH"
+};
+
+static const char *menuMusicNames[MENUMUSIC_COUNT] = {
+	"flow-song1",
+	"flow-song-3-intro"
+};
+
+static const char *gameMusicNames[GAMEMUSIC_COUNT] = {
+	"flow-song2",
+	"flow-song-3-game"
+};
+
 typedef enum GameState
 {
 	GAMESTATE_EXIT,
@@ -65,6 +84,15 @@ typedef enum GameState
 	GAMESTATE_PAUSE
 } GameState;
 
+// the trace scope of a switchState to each state
+static const char *switchStateNames[] = {
+	"switchState EXIT",
+	"switchState INTRO",
+	"switchState MENU",
+	"switchState PLAY",
+	"switchState PAUSE"
+};
+
 typedef struct Sprite
 {
 	SDL_Texture *texture;
@@ -87,6 +115,9 @@ typedef struct Menu
 	MenuButton *play8_8;
 	MenuButton *play9_9;
 	MenuButton *play10_10;
+	MenuButton *play50_50;
+	// only there when there is a saved game
+	MenuButton *resume;
 	MenuButton *exit;
 } Menu;
 
@@ -95,22 +126,30 @@ typedef struct Game
 {
 	SDL_Window *window;
 	SDL_Renderer *renderer;
-	Mix_Chunk *sound[SOUND_COUNT];
-	Mix_Music *menuMusic[MENUMUSIC_COUNT];
-	Mix_Music *gameMusic[GAMEMUSIC_COUNT];
+	Audio audio;
 	TTF_Font *font;
+	TextAtlas text;
 	Menu menu;
 	u64 dt;
 	u64 lastTime;
 	bool isTimerStarted;
 	u64 gameTimer;
+	// won or lost, so there is nothing to save any more
+	bool finished;
+	// a saved game menuResume read, for playInit to take over
+	Board *resumeBoard;
+	SaveGame resume;
 	u64 introTimer;
 	Sprite splash;
 	i32 boardSize;
 	Board *board;
+	GenPool genPool;
+	GenJob *genJob;
+	BoardGen *boardGen;
 	bool running;
 	GameState state;
-	SDL_Point mouse;
+	// cell the last mouse motion ended in, where the next drag line starts
+	SDL_Point dragCell;
 	bool isHovered;
 	SDL_Point hoveredCell;
 	bool piping;
@@ -119,8 +158,25 @@ typedef struct Game
 	CellState endPoint;
 	CellColor selectedColor;
 	SDL_Rect boardDim;
-	i32 cellWidth;
-	i32 cellHeight;
+	Camera camera;
+	CellTexture cellTexture;
+	PipeMesh pipeMesh;
+	// scratch for drawHint, drawn like the pipes but built every frame
+	PipeMesh hintMesh;
+	// the last frame drew the generator's snapshot, not the board
+	bool drewSnapshot;
+	bool panning;
+	Profiler profiler;
+	// allocations and textures of the last play frame, and how many play
+	// frames had any, with FLOW_TRACK_ALLOCS
+	MemFrame memFrame;
+	u64 playFrames;
+	u64 allocFrames;
+	GenConfig genConfig;
+	Palette palette;
+	bool showGlyphs;
+	Hint hint;
+	bool hasHint;
 } Game;
 
 
@@ -129,9 +185,6 @@ void quitSDL();
 bool inBounds(i32, i32, SDL_Rect);
 bool pointsEqual(SDL_Point, SDL_Point);
 bool pointsAdjacent(SDL_Point, SDL_Point);
-void drawPipeEnd(SDL_Renderer*, SDL_Rect*, SDL_Color);
-void drawPipeSection(SDL_Renderer*, SDL_Rect*, CellConnection, SDL_Color);
-void drawPipe(SDL_Renderer*, SDL_Rect*, Cell*);
 void setCellConnection(Board*, SDL_Point, SDL_Point);
 void clearPipe(Board *b, CellColor color);
 SDL_Texture* createSDLText(SDL_Renderer*, const char*, TTF_Font*, SDL_Color);
@@ -149,11 +202,24 @@ void menuLoop(Game *g);
 void menuInput(Game *g);
 void menuDraw(Game *g);
 void menuExit(Game *g);
+bool menuResume(Game *g);
 void playInit(Game *g);
+void playResume(Game *g);
+void playBoardReady(Game *g);
+void playSave(Game *g);
 void playLoop(Game *g);
 void playInput(Game *g);
+bool playDragTo(Game *g, SDL_Point cell);
+bool playDragLine(Game *g, SDL_Point from, SDL_Point to);
+bool playMouseMoved(Game *g, i32 x, i32 y);
+void playZoom(Game *g, i32 notches);
 void playDraw(Game *g);
 void playExit(Game *g);
+void playHint(Game *g);
+void drawHint(Game *g);
+void drawTimer(Game *g);
+void drawProfiler(Game *g);
+void playDebugKey(Game *g, SDL_Keycode key);
 void pauseInit(Game *g);
 void pauseLoop(Game *g);
 void pauseInput(Game *g);
@@ -215,73 +281,6 @@ bool pointsAdjacent(SDL_Point a, SDL_Point b)
 	return (xDiff + yDiff == 1) && (xDiff == 0 || yDiff == 0);
 }
 
-void drawPipeEnd(SDL_Renderer *renderer, SDL_Rect *cellDim, SDL_Color color)
-{
-	SDL_Rect circle = {
-		cellDim->x + (0.2 * cellDim->w),
-		cellDim->y + (0.2 * cellDim->h),
-		cellDim->w - (0.4 * cellDim->w),
-		cellDim->h - (0.4 * cellDim->h)
-	};
-	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-	SDL_RenderFillRect(renderer, &circle);
-}
-
-void drawPipeSection(SDL_Renderer *renderer, SDL_Rect *cellDim,
-                     CellConnection connection, SDL_Color color)
-{
-	SDL_Rect dest;
-	switch (connection)
-	{
-		case CELLCONNECTION_UP:
-			dest.x = cellDim->x + (cellDim->w / 2);
-			dest.y = cellDim->y - (cellDim->h / 2);
-			dest.h = cellDim->h;
-			dest.w = cellDim->w / 10;
-			break;
-		case CELLCONNECTION_DOWN:
-			dest.x = cellDim->x + (cellDim->w / 2);
-			dest.y = cellDim->y + (cellDim->h / 2);
-			dest.h = cellDim->h;
-			dest.w = cellDim->w / 10;
-			break;
-		case CELLCONNECTION_LEFT:
-			dest.x = cellDim->x - (cellDim->w / 2);
-			dest.y = cellDim->y + (cellDim->h / 2);
-			dest.h = cellDim->h / 10;
-			dest.w = cellDim->w;
-			break;
-		case CELLCONNECTION_RIGHT:
-			dest.x = cellDim->x + (cellDim->w / 2);
-			dest.y = cellDim->y + (cellDim->h / 2);
-			dest.h = cellDim->h / 10;
-			dest.w = cellDim->w;
-			break;
-		default:
-		case CELLCONNECTION_NONE:
-			break;
-	}
-	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-	SDL_RenderFillRect(renderer, &dest);
-}
-
-void drawPipe(SDL_Renderer *renderer, SDL_Rect *cellDim, Cell *cell)
-{
-	SDL_Color color = colorMap[cell->color];
-
-	if (   cell->state == CELLSTATE_PIPE_START
-	    || cell->state == CELLSTATE_PIPE_END)
-	{
-		drawPipeEnd(renderer, cellDim, color);
-	}
-
-	if (   cell->state      != CELLSTATE_EMPTY
-		&& cell->connection != CELLCONNECTION_NONE)
-	{
-		drawPipeSection(renderer, cellDim, cell->connection, color);
-	}
-}
-
 void setCellConnection(Board *board, SDL_Point cell1, SDL_Point cell2)
 {
 	if (cell2.x > cell1.x)
@@ -300,10 +299,10 @@ void setCellConnection(Board *board, SDL_Point cell1, SDL_Point cell2)
 
 void clearPipe(Board *b, CellColor color)
 {
-	for (i32 i = 0; i < b->width * b->height; i++)
+	for (i32 i = 0; i < b->numCells; i++)
 	{
 		Cell *cell = &b->cells[i];
-		if (cell->color == color)
+		if (cell->color == color && cell->state != CELLSTATE_WALL)
 		{
 			cell->connection = CELLCONNECTION_NONE;
 			if (   cell->state != CELLSTATE_PIPE_START
@@ -325,7 +324,7 @@ SDL_Texture* createSDLText(SDL_Renderer *rdr, const char *text, TTF_Font *font,
 		fprintf(stderr, "TTF_RenderText: %s\n", TTF_GetError());
 		return NULL;
 	}
-	SDL_Texture *texture = SDL_CreateTextureFromSurface(rdr, surf);
+	SDL_Texture *texture = memTexture(SDL_CreateTextureFromSurface(rdr, surf));
 	if (!texture)
 	{
 		fprintf(stderr, "SDL_CreateTexture: %s\n", SDL_GetError());
@@ -339,7 +338,7 @@ MenuButton* createMenuButton(SDL_Texture *texture, i32 x, i32 y)
 	if (!texture)
 		return NULL;
 
-	MenuButton *button = malloc(sizeof(MenuButton));
+	MenuButton *button = memAlloc(sizeof(MenuButton));
 	if (!button)
 		return NULL;
 
@@ -366,8 +365,8 @@ void destroyMenuButton(MenuButton *button)
 {
 	if (!button)
 		return;
-	SDL_DestroyTexture(button->texture);
-	free(button);
+	memDestroyTexture(button->texture);
+	memFree(button);
 }
 
 void switchState(Game *g, GameState state)
@@ -377,6 +376,7 @@ void switchState(Game *g, GameState state)
 		return;
 	}
 
+	traceBegin(switchStateNames[state]);
 	if (state > g->state)
 	{
 		for (i32 gs = g->state + 1; gs <= state; gs++)
@@ -428,35 +428,35 @@ void switchState(Game *g, GameState state)
 	}
 
 	g->state = state;
+	traceEnd(switchStateNames[state]);
 }
 
 void introInit(Game *g)
 {
-	if (!startSDL()
-		|| !(g->window
-		     = SDL_CreateWindow("flow", 1920, 0, 800, 600, SDL_WINDOW_SHOWN))
-
-		|| !(g->renderer
-		     = SDL_CreateRenderer(g->window, -1, SDL_RENDERER_ACCELERATED))
-
-		|| !(g->sound[SOUND_CLICK] = Mix_LoadWAV("assets/Audio/click_001.wav"))
-
-		|| !(g->sound[SOUND_YUH]   = Mix_LoadWAV("assets/Audio/YUH.wav"))
-
-		|| !(g->menuMusic[MENUMUSIC_001]
-		     = Mix_LoadMUS("assets/Audio/flow-song1.wav"))
-
-		|| !(g->menuMusic[MENUMUSIC_002]
-		     = Mix_LoadMUS("assets/Audio/flow-song-3-intro.wav"))
-
-		|| !(g->gameMusic[GAMEMUSIC_001]
-		     = Mix_LoadMUS("assets/Audio/flow-song2.wav"))
-
-		|| !(g->gameMusic[GAMEMUSIC_002]
-		     = Mix_LoadMUS("assets/Audio/flow-song-3-game.wav"))
-
-		|| !(g->font
-		     = TTF_OpenFont("assets/Fonts/IosevkaTermNerdFont-Bold.ttf", 24)))
+	profilerInit(&g->profiler);
+
+	// each load its own trace scope, stopping at the first that fails
+	traceBegin("startSDL");
+	bool started = startSDL()
+		&& (g->window
+		    = SDL_CreateWindow("flow", 1920, 0, 800, 600, SDL_WINDOW_SHOWN))
+
+		&& (g->renderer
+		    = SDL_CreateRenderer(g->window, -1, SDL_RENDERER_ACCELERATED));
+	traceEnd("startSDL");
+
+	traceBegin("audioInit");
+	started = started && audioInit(&g->audio, soundNames, SOUND_COUNT);
+	traceEnd("audioInit");
+
+	traceBegin("TTF_OpenFont");
+	started = started
+		&& (g->font
+		    = TTF_OpenFont("assets/Fonts/IosevkaTermNerdFont-Bold.ttf", 24))
+		&& textAtlasInit(&g->text, g->renderer, g->font);
+	traceEnd("TTF_OpenFont");
+
+	if (!started)
 	{
 		fprintf(stderr, "Failed to initialize\n");
 		fprintf(stderr, "SDL Error: %s\n", SDL_GetError());
@@ -466,12 +466,27 @@ void introInit(Game *g)
 		return;
 	}
 
+#ifndef FLOW_NO_THREADS
+	traceBegin("genPoolInit");
+	bool pooled = genPoolInit(&g->genPool, 0);
+	traceEnd("genPoolInit");
+	if (!pooled)
+	{
+		switchState(g, GAMESTATE_EXIT);
+		return;
+	}
+#endif
+
 	srand(time(NULL));
+	g->genConfig = boardDefaultGenConfig();
+	g->showGlyphs = false;
 	g->boardSize = DEFAULT_BOARD_SIZE;
 	g->running = true;
 	g->introTimer = 3000;
+	traceBegin("IMG_LoadTexture");
 	g->splash.texture
-	    = IMG_LoadTexture(g->renderer, "assets/Sprites/splash.png");
+	    = memTexture(IMG_LoadTexture(g->renderer, "assets/Sprites/splash.png"));
+	traceEnd("IMG_LoadTexture");
 	if (!g->splash.texture)
 	{
 		fprintf(stderr, "Failed to load splash texture\n");
@@ -516,14 +531,11 @@ void introDraw(Game *g)
 
 void introExit(Game *g)
 {
-	SDL_DestroyTexture(g->splash.texture);
+	genPoolQuit(&g->genPool);
+	memDestroyTexture(g->splash.texture);
+	textAtlasFree(&g->text);
 	TTF_CloseFont(g->font);
-	for (i32 i = 0; i < SOUND_COUNT; i++)
-		Mix_FreeChunk(g->sound[i]);
-	for (i32 i = 0; i < MENUMUSIC_COUNT; i++)
-		Mix_FreeMusic(g->menuMusic[i]);
-	for (i32 i = 0; i < GAMEMUSIC_COUNT; i++)
-		Mix_FreeMusic(g->gameMusic[i]);
+	audioFree(&g->audio);
 	SDL_DestroyRenderer(g->renderer);
 	SDL_DestroyWindow(g->window);
 	quitSDL();
@@ -531,7 +543,8 @@ void introExit(Game *g)
 
 void menuInit(Game *g)
 {
-	SDL_Texture *welcomeMsgt, *play8x8t, *play9x9t, *play10x10t, *exit;
+	SDL_Texture *welcomeMsgt, *play8x8t, *play9x9t, *play10x10t, *play50x50t;
+	SDL_Texture *exit, *resumet;
 	SDL_Color white = {255, 255, 255, 255};
 	SDL_Color green = {  0, 255,   0, 255};
 
@@ -539,7 +552,11 @@ void menuInit(Game *g)
 	play8x8t   = createSDLText(g->renderer, "Play 8x8",        g->font, white);
 	play9x9t   = createSDLText(g->renderer, "Play 9x9",        g->font, white);
 	play10x10t = createSDLText(g->renderer, "Play 10x10",      g->font, white);
+	play50x50t = createSDLText(g->renderer, "Play 50x50",      g->font, white);
 	exit       = createSDLText(g->renderer, "Exit",            g->font, white);
+	resumet    = saveExists(SAVE_PATH)
+	             ? createSDLText(g->renderer, "Resume",        g->font, white)
+	             : NULL;
 
 	i32 ww, wh;
 	SDL_GetWindowSize(g->window, &ww, &wh);
@@ -548,9 +565,12 @@ void menuInit(Game *g)
 	g->menu.play8_8    = createMenuButton(play8x8t,    ww / 2, wh*2 / 11);
 	g->menu.play9_9    = createMenuButton(play9x9t,    ww / 2, wh*3 / 11);
 	g->menu.play10_10  = createMenuButton(play10x10t,  ww / 2, wh*4 / 11);
-	g->menu.exit       = createMenuButton(exit,        ww / 2, wh*5 / 11);
+	g->menu.play50_50  = createMenuButton(play50x50t,  ww / 2, wh*5 / 11);
+	g->menu.resume     = createMenuButton(resumet,     ww / 2, wh*6 / 11);
+	g->menu.exit       = createMenuButton(exit,        ww / 2, wh*7 / 11);
 
-	Mix_PlayMusic(g->menuMusic[MENUMUSIC_001], -1);
+	audioPlayMusic(&g->audio, menuMusicNames[MENUMUSIC_001]);
+	audioReport(&g->audio);
 }
 
 void menuLoop(Game *g)
@@ -573,7 +593,12 @@ void menuInput(Game *g)
 	g->menu.play8_8->hovered    = inBounds(mx, my, g->menu.play8_8->bounds);
 	g->menu.play9_9->hovered    = inBounds(mx, my, g->menu.play9_9->bounds);
 	g->menu.play10_10->hovered  = inBounds(mx, my, g->menu.play10_10->bounds);
+	g->menu.play50_50->hovered  = inBounds(mx, my, g->menu.play50_50->bounds);
 	g->menu.exit->hovered       = inBounds(mx, my, g->menu.exit->bounds);
+	if (g->menu.resume)
+	{
+		g->menu.resume->hovered = inBounds(mx, my, g->menu.resume->bounds);
+	}
 
 	if (mb & SDL_BUTTON(SDL_BUTTON_LEFT))
 	{
@@ -592,6 +617,16 @@ void menuInput(Game *g)
 			g->boardSize = 10;
 			switchState(g, GAMESTATE_PLAY);
 		}
+		else if (g->menu.play50_50->hovered)
+		{
+			g->boardSize = 50;
+			switchState(g, GAMESTATE_PLAY);
+		}
+		else if (g->menu.resume && g->menu.resume->hovered)
+		{
+			if (menuResume(g))
+				switchState(g, GAMESTATE_PLAY);
+		}
 		else if (g->menu.exit->hovered)
 		{
 			switchState(g, GAMESTATE_EXIT);
@@ -631,6 +666,9 @@ void menuDraw(Game *g)
 	drawMenuButton(g->renderer, g->menu.play8_8);
 	drawMenuButton(g->renderer, g->menu.play9_9);
 	drawMenuButton(g->renderer, g->menu.play10_10);
+	drawMenuButton(g->renderer, g->menu.play50_50);
+	if (g->menu.resume)
+		drawMenuButton(g->renderer, g->menu.resume);
 	drawMenuButton(g->renderer, g->menu.exit);
 }
 
@@ -640,53 +678,367 @@ void menuExit(Game *g)
 	destroyMenuButton(g->menu.play8_8);
 	destroyMenuButton(g->menu.play9_9);
 	destroyMenuButton(g->menu.play10_10);
+	destroyMenuButton(g->menu.play50_50);
+	destroyMenuButton(g->menu.resume);
 	destroyMenuButton(g->menu.exit);
 }
 
+// Reads the saved game for playInit. A save that does not check out is
+// removed, so the menu stops offering it.
+bool menuResume(Game *g)
+{
+	Board *board = saveRead(SAVE_PATH, &g->resume);
+	if (board && board->width != board->height)
+	{
+		fprintf(stderr, "%s holds a board that is not square\n", SAVE_PATH);
+		saveFree(&g->resume);
+		boardFree(board);
+		board = NULL;
+	}
+	if (!board)
+	{
+		saveRemove(SAVE_PATH);
+		destroyMenuButton(g->menu.resume);
+		g->menu.resume = NULL;
+		return false;
+	}
+
+	g->resumeBoard = board;
+	g->boardSize = board->width;
+	return true;
+}
+
 void playInit(Game *g)
 {
-	g->board = boardCreate(g->boardSize, g->boardSize);
-	SDL_ThreadFunction boardGenFunc = (SDL_ThreadFunction)boardGenerate;
-	SDL_CreateThread(boardGenFunc, "boardGenThread", g->board);
+	// a saved board is complete, there is nothing to generate
+	bool resuming = g->resumeBoard != NULL;
+	if (resuming)
+	{
+		g->board = g->resumeBoard;
+		g->resumeBoard = NULL;
+	}
+	else
+	{
+		g->board = boardCreate(g->boardSize, g->boardSize);
+		g->board->genConfig = g->genConfig;
+#ifdef FLOW_NO_THREADS
+		g->boardGen = boardGenerateBegin(g->board);
+#else
+		boardEnableSnapshots(g->board);
+		g->genJob = genPoolSubmit(&g->genPool, g->board);
+#endif
+	}
 
 	i32 windowWidth, windowHeight;
 	SDL_GetWindowSize(g->window, &windowWidth, &windowHeight);
-	g->boardDim = (SDL_Rect){
-		(windowWidth - (windowWidth * 0.8)) / 2,
-		(windowHeight - (windowHeight * 0.8)) / 2,
-		windowWidth * 0.8,
-		windowHeight * 0.8
-	};
-	g->cellWidth = g->boardDim.w / g->boardSize;
-	g->cellHeight = g->boardDim.h / g->boardSize;
+	g->boardDim = drawBoardView(windowWidth, windowHeight);
+	cameraInit(&g->camera, g->boardDim, g->boardSize, g->boardSize);
+	g->panning = false;
+	g->drewSnapshot = false;
+
+	// without it the board is drawn cell by cell at every zoom
+	if (!cellTextureInit(&g->cellTexture, g->renderer,
+	                     g->boardSize, g->boardSize))
+	{
+		fprintf(stderr, "SDL_CreateTexture: %s\n", SDL_GetError());
+	}
 
-	g->selectedColor = CELLCOLOR_RED;
+	g->selectedColor = 0;
 	g->piping = false;
 	g->endPoint = CELLSTATE_PIPE_END;
 
-	g->pipeSeq = malloc(sizeof(SDL_Point) * g->boardSize * g->boardSize);
+	g->pipeSeq = memAlloc(sizeof(SDL_Point) * g->boardSize * g->boardSize);
+
+	// the generator runs in the background, so size the palette for the
+	// most pipes a board this big can hold
+	paletteInit(&g->palette, g->boardSize * g->boardSize / 3);
+	pipeMeshInit(&g->pipeMesh, g->boardSize * g->boardSize / 3);
+	pipeMeshInit(&g->hintMesh, 1);
 	g->pipeSeqSize = 0;
 
 	g->isHovered = false;
 	g->hoveredCell = (SDL_Point){0, 0};
+	g->dragCell = (SDL_Point){0, 0};
 	g->running = true;
 
 	g->lastTime = SDL_GetTicks64();
 
 	g->isTimerStarted = false;
+	g->finished = false;
+	g->hasHint = false;
+	if (resuming)
+		playResume(g);
+
+	audioPlayMusic(&g->audio, gameMusicNames[GAMEMUSIC_001]);
+
+	// the first frame counts from here, not from everything set up above
+	memFrameEnd();
+	g->playFrames = 0;
+	g->allocFrames = 0;
+}
+
+// picks up the game menuResume read where it was saved
+void playResume(Game *g)
+{
+	SaveGame *save = &g->resume;
+	memcpy(g->pipeSeq, save->pipeSeq, sizeof(SDL_Point) * save->pipeSeqSize);
+	g->pipeSeqSize = save->pipeSeqSize;
+	g->selectedColor = save->selectedColor;
+	g->endPoint = save->endPoint;
+	g->piping = save->piping && save->pipeSeqSize > 0;
+	g->gameTimer = save->gameTimer;
+	g->isTimerStarted = save->timerStarted;
+	saveFree(save);
+
+	// a drag does not outlive the button that made it, one saved halfway
+	// ends the way letting go would have ended it
+	u32 buttons = SDL_GetMouseState(NULL, NULL);
+	if (g->piping && !(buttons & SDL_BUTTON(SDL_BUTTON_LEFT)))
+	{
+		clearPipe(g->board, g->selectedColor);
+		g->piping = false;
+		g->pipeSeqSize = 0;
+	}
+	if (g->piping)
+		g->dragCell = g->pipeSeq[g->pipeSeqSize - 1];
+
+	if (g->isTimerStarted)
+		playBoardReady(g);
+}
+
+// once the board is there to play, generated or resumed
+void playBoardReady(Game *g)
+{
+	g->hasHint = g->boardSize < LARGE_BOARD_SIZE
+	             && hintInit(&g->hint, g->board, HINT_INIT_NODES);
+
+	// the generator's last snapshot is not the board it handed over
+	cellTextureTouch(&g->cellTexture, 0, g->boardSize - 1);
+	pipeMeshTouch(&g->pipeMesh, -1);
+}
 
-	Mix_PlayMusic(g->gameMusic[GAMEMUSIC_001], -1);
+// the game in play to SAVE_PATH, on every completed flow and on the way
+// out of the play state
+void playSave(Game *g)
+{
+	SaveGame save = {
+		.gameTimer = g->gameTimer,
+		.timerStarted = g->isTimerStarted,
+		.piping = g->piping,
+		.selectedColor = g->selectedColor,
+		.endPoint = g->endPoint,
+		.pipeSeq = g->pipeSeq,
+		.pipeSeqSize = g->pipeSeqSize
+	};
+	saveWrite(SAVE_PATH, g->board, &save);
 }
 
 void playLoop(Game *g)
 {
+	Profiler *prof = &g->profiler;
+
+	profilerBegin(prof, PROFPHASE_INPUT);
+	traceBegin("playInput");
 	playInput(g);
+	traceEnd("playInput");
+	profilerEnd(prof, PROFPHASE_INPUT);
 	while (g->running && g->state == GAMESTATE_PLAY)
 	{
+		if (g->boardGen)
+		{
+			traceBegin("boardGenerateStep");
+			bool generated = boardGenerateStep(g->boardGen, 0,
+			                                   GENERATE_SLICE_US);
+			traceEnd("boardGenerateStep");
+			if (generated)
+			{
+				boardGenerateEnd(g->boardGen);
+				g->boardGen = NULL;
+			}
+		}
+
+		profilerBegin(prof, PROFPHASE_DRAW);
+		traceBegin("playDraw");
 		playDraw(g);
+		traceEnd("playDraw");
+		profilerEnd(prof, PROFPHASE_DRAW);
+
+		if (prof->enabled)
+			drawProfiler(g);
+
+		profilerBegin(prof, PROFPHASE_PRESENT);
+		traceBegin("SDL_RenderPresent");
 		SDL_RenderPresent(g->renderer);
+		traceEnd("SDL_RenderPresent");
+		profilerEnd(prof, PROFPHASE_PRESENT);
+
+		profilerBegin(prof, PROFPHASE_INPUT);
+		traceBegin("playInput");
 		playInput(g);
+		traceEnd("playInput");
+		profilerEnd(prof, PROFPHASE_INPUT);
+
+		profilerFrameEnd(prof);
+
+		g->memFrame = memFrameEnd();
+		g->playFrames += 1;
+		if (g->memFrame.allocs > 0 || g->memFrame.texturesCreated > 0)
+			g->allocFrames += 1;
+	}
+}
+
+// Takes the pipe being drawn onto cell, or back off the last one when
+// cell is the one before it. Cells that are not next to the end of the
+// pipe are left alone. False once the board is solved and replaced.
+bool playDragTo(Game *g, SDL_Point cell)
+{
+	if (   !g->piping
+	    || !boardBoundsCheck(g->board, cell.y, cell.x)
+	    || !pointsAdjacent(cell, g->pipeSeq[g->pipeSeqSize - 1]))
+	{
+		return true;
+	}
+
+	Cell *hovered = boardGet(g->board, cell.y, cell.x);
+
+	// the cell and, backing off, the pipe's end next to it
+	cellTextureTouch(&g->cellTexture, cell.y - 1, cell.y + 1);
+	pipeMeshTouch(&g->pipeMesh, g->selectedColor);
+
+	if (hovered->state == CELLSTATE_EMPTY
+		|| (   hovered->state == g->endPoint
+	        && hovered->color == g->selectedColor))
+	{
+		g->pipeSeq[g->pipeSeqSize] = cell;
+		g->pipeSeqSize += 1;
+		if (g->pipeSeqSize > 1)
+		{
+			SDL_Point *prevPipe = &g->pipeSeq[g->pipeSeqSize - 2];
+			SDL_Point *currPipe = &g->pipeSeq[g->pipeSeqSize - 1];
+			setCellConnection(g->board, *prevPipe, *currPipe);
+		}
+
+		if (hovered->state == g->endPoint)
+		{
+			g->piping = false;
+			g->pipeSeqSize = 0;
+			audioPlayEffect(&g->audio, SOUND_YUH);
+
+			// TODO: if player solves board with less than all pipes,
+			// will not trigger
+			bool solved = true;
+			for (i32 i = 0; i < g->board->numCells; i++)
+			{
+				if (g->board->cells[i].state == CELLSTATE_EMPTY)
+				{
+					solved = false;
+					break;
+				}
+			}
+			if (solved)
+			{
+				g->finished = true;
+				saveRemove(SAVE_PATH);
+				switchState(g, GAMESTATE_MENU);
+				switchState(g, GAMESTATE_PLAY);
+				return false;
+			}
+			playSave(g);
+		}
+		else
+		{
+			hovered->color = g->selectedColor;
+			boardSetState(g->board, cell.y, cell.x, CELLSTATE_PIPE);
+			audioPlayEffect(&g->audio, SOUND_CLICK);
+		}
+	}
+	else if (g->pipeSeqSize > 1)
+	{
+		SDL_Point *prevPipe = &g->pipeSeq[g->pipeSeqSize - 2];
+		SDL_Point *currPipe = &g->pipeSeq[g->pipeSeqSize - 1];
+		if (pointsEqual(cell, *prevPipe))
+		{
+			boardGet(g->board, (*currPipe).y, (*currPipe).x)->state
+			    = CELLSTATE_EMPTY;
+			(*currPipe) = (SDL_Point){0, 0};
+
+			boardGet(g->board, (*prevPipe).y, (*prevPipe).x)->connection
+				= CELLCONNECTION_NONE;
+
+			g->pipeSeqSize -= 1;
+			audioPlayEffect(&g->audio, SOUND_CLICK);
+		}
+	}
+	return true;
+}
+
+// The cells a straight line from one cell to another crosses, in order,
+// each next to the one before so the pipe can follow them: Bresenham in
+// cell space, stepping along one axis at a time. The drag is taken over
+// every one of them. False once the board is solved and replaced.
+bool playDragLine(Game *g, SDL_Point from, SDL_Point to)
+{
+	i32 dx = abs(to.x - from.x);
+	i32 dy = abs(to.y - from.y);
+	i32 sx = to.x > from.x ? 1 : -1;
+	i32 sy = to.y > from.y ? 1 : -1;
+	i32 error = dx - dy;
+	SDL_Point cell = from;
+
+	for (i32 n = dx + dy; n > 0; n--)
+	{
+		if (error > 0)
+		{
+			cell.x += sx;
+			error -= 2 * dy;
+		}
+		else
+		{
+			cell.y += sy;
+			error += 2 * dx;
+		}
+		if (!playDragTo(g, cell))
+			return false;
 	}
+	return true;
+}
+
+// Every motion event moves the hovered cell, and while a pipe is drawn
+// it follows the line from where the mouse was to where it is, however
+// many cells that crosses. False once the board is solved and replaced.
+bool playMouseMoved(Game *g, i32 x, i32 y)
+{
+	SDL_Point cell = cameraCellAt(&g->camera, x, y);
+	SDL_Point from = g->dragCell;
+	g->hoveredCell = cell;
+	g->dragCell = cell;
+
+	// zoomed in, cells of the board lie outside the view too
+	g->isHovered = inBounds(x, y, g->boardDim)
+	               && boardBoundsCheck(g->board, cell.y, cell.x);
+
+	if (!g->piping)
+		return true;
+	return playDragLine(g, from, cell);
+}
+
+// The wheel zooms about the mouse, a notch at a time. The cell under the
+// mouse changes without the mouse moving, so a pipe being drawn starts
+// its next line from there rather than from the cell before the zoom.
+void playZoom(Game *g, i32 notches)
+{
+	i32 x, y;
+	SDL_GetMouseState(&x, &y);
+	if (!inBounds(x, y, g->boardDim))
+		return;
+
+	for (i32 i = 0; i < notches; i++)
+		cameraZoom(&g->camera, CAMERA_ZOOM_STEP, x, y);
+	for (i32 i = 0; i > notches; i--)
+		cameraZoom(&g->camera, 1.0f / CAMERA_ZOOM_STEP, x, y);
+
+	g->dragCell = cameraCellAt(&g->camera, x, y);
+	g->hoveredCell = g->dragCell;
 }
 
 void playInput(Game *g)
@@ -698,7 +1050,7 @@ void playInput(Game *g)
 	g->dt = (currTime - g->lastTime);
 	g->lastTime = currTime;
 
-	if (g->board->genState != GENSTATE_IDLE)
+	if (g->boardGen || (g->genJob && !genJobDone(g->genJob)))
 	{
 		SDL_Event event;
 		while (SDL_PollEvent(&event))
@@ -717,6 +1069,7 @@ void playInput(Game *g)
 					{
 						switchState(g, GAMESTATE_PAUSE);
 					}
+					playDebugKey(g, event.key.keysym.sym);
 					break;
 			}
 		}
@@ -729,100 +1082,18 @@ void playInput(Game *g)
 			g->isTimerStarted = true;
 			g->gameTimer = 1000 * 60 * 1;
 			g->gameTimer += 15000;
+			playBoardReady(g);
 		}
 	}
 
 	g->gameTimer -= g->dt;
 	if (g->gameTimer <= 0)
 	{
+		g->finished = true;
+		saveRemove(SAVE_PATH);
 		switchState(g, GAMESTATE_MENU);
 	}
 
-	SDL_Point mouse;
-	SDL_GetMouseState(&mouse.x, &mouse.y);
-
-	if (inBounds(mouse.x, mouse.y, g->boardDim))
-	{
-		g->isHovered = true;
-		g->hoveredCell.y = (mouse.y - g->boardDim.y) / g->cellHeight;
-		g->hoveredCell.x = (mouse.x - g->boardDim.x) / g->cellWidth;
-
-		if (g->piping
-		    && boardBoundsCheck(g->board, g->hoveredCell.y, g->hoveredCell.x)
-			&& pointsAdjacent(g->hoveredCell, g->pipeSeq[g->pipeSeqSize - 1]))
-		{
-			Cell* hovered
-			    = boardGet(g->board, g->hoveredCell.y, g->hoveredCell.x);
-
-			if (hovered->state == CELLSTATE_EMPTY
-				|| (   hovered->state == g->endPoint
-			        && hovered->color == g->selectedColor))
-			{
-				g->pipeSeq[g->pipeSeqSize] = g->hoveredCell;
-				g->pipeSeqSize += 1;
-				if (g->pipeSeqSize > 1)
-				{
-					SDL_Point *prevPipe = &g->pipeSeq[g->pipeSeqSize - 2];
-					SDL_Point *currPipe = &g->pipeSeq[g->pipeSeqSize - 1];
-					setCellConnection(g->board, *prevPipe, *currPipe);
-				}
-
-				if (hovered->state == g->endPoint)
-				{
-					g->piping = false;
-					g->pipeSeqSize = 0;
-					Mix_PlayChannel(-1, g->sound[SOUND_YUH], 0);
-
-					// TODO: if player solves board with less than all pipes,
-					// will not trigger
-					bool solved = true;
-					for (i32 i = 0; i < g->board->width * g->board->height; i++)
-					{
-						if (g->board->cells[i].state == CELLSTATE_EMPTY)
-						{
-							solved = false;
-							break;
-						}
-					}
-					if (solved)
-					{
-						switchState(g, GAMESTATE_MENU);
-						switchState(g, GAMESTATE_PLAY);
-						return;
-					}
-				}
-				else
-				{
-					hovered->color = g->selectedColor;
-					boardSetState(g->board, g->hoveredCell.y, g->hoveredCell.x,
-					    CELLSTATE_PIPE);
-					Mix_PlayChannel(-1, g->sound[SOUND_CLICK], 0);
-				}
-			}
-			else if (g->pipeSeqSize > 1)
-			{
-				SDL_Point *prevPipe = &g->pipeSeq[g->pipeSeqSize - 2];
-				SDL_Point *currPipe = &g->pipeSeq[g->pipeSeqSize - 1];
-				if (pointsEqual(g->hoveredCell, *prevPipe))
-				{
-					boardGet(g->board, (*currPipe).y, (*currPipe).x)->state
-					    = CELLSTATE_EMPTY;
-					(*currPipe) = (SDL_Point){0, 0};
-
-					boardGet(g->board, (*prevPipe).y, (*prevPipe).x)->connection
-						= CELLCONNECTION_NONE;
-
-					g->pipeSeqSize -= 1;
-					Mix_PlayChannel(-1, g->sound[SOUND_CLICK], 0);
-				}
-			}
-		}
-	}
-	else
-	{
-		g->isHovered = false;
-	}
-
 	SDL_Event event;
 	while (SDL_PollEvent(&event))
 	{
@@ -831,8 +1102,29 @@ void playInput(Game *g)
 			case SDL_QUIT:
 				g->running = false;
 				break;
+			case SDL_MOUSEMOTION:
+				if (g->panning)
+				{
+					cameraPan(&g->camera,
+					          event.motion.xrel, event.motion.yrel);
+				}
+				if (!playMouseMoved(g, event.motion.x, event.motion.y))
+					return;
+				break;
+			case SDL_MOUSEWHEEL:
+				playZoom(g, event.wheel.y);
+				break;
 			case SDL_MOUSEBUTTONDOWN:
-				if (!g->piping && g->isHovered)
+				if (event.button.button == SDL_BUTTON_RIGHT)
+				{
+					g->panning = true;
+					break;
+				}
+				if (!playMouseMoved(g, event.button.x, event.button.y))
+					return;
+				if (   event.button.button == SDL_BUTTON_LEFT
+				    && !g->piping
+				    && g->isHovered)
 				{
 					Cell *hovered
 					    = boardGet(g->board, g->hoveredCell.y, g->hoveredCell.x);
@@ -847,13 +1139,21 @@ void playInput(Game *g)
 							? CELLSTATE_PIPE_END
 							: CELLSTATE_PIPE_START;
 						clearPipe(g->board, g->selectedColor);
+						cellTextureTouch(&g->cellTexture, 0, g->boardSize - 1);
+						pipeMeshTouch(&g->pipeMesh, g->selectedColor);
 					}
 				}
 				break;
 			case SDL_MOUSEBUTTONUP:
-				if (g->piping)
+				if (event.button.button == SDL_BUTTON_RIGHT)
+				{
+					g->panning = false;
+				}
+				else if (g->piping)
 				{
 					clearPipe(g->board, g->selectedColor);
+					cellTextureTouch(&g->cellTexture, 0, g->boardSize - 1);
+					pipeMeshTouch(&g->pipeMesh, g->selectedColor);
 					g->piping = false;
 				}
 				break;
@@ -862,6 +1162,15 @@ void playInput(Game *g)
 				{
 					switchState(g, GAMESTATE_PAUSE);
 				}
+				if (event.key.keysym.sym == SDLK_g)
+				{
+					g->showGlyphs = !g->showGlyphs;
+				}
+				if (event.key.keysym.sym == SDLK_h && g->hasHint)
+				{
+					playHint(g);
+				}
+				playDebugKey(g, event.key.keysym.sym);
 				break;
 		}
 	}
@@ -871,55 +1180,233 @@ void playDraw(Game *g)
 {
 	SDL_SetRenderDrawColor(g->renderer, 50, 50, 50, 255);
 	SDL_RenderClear(g->renderer);
-	SDL_SetRenderDrawColor(g->renderer, 25, 25, 25, 255);
-	SDL_RenderFillRect(g->renderer, &g->boardDim);
 
-	for (i32 r = 0; r < g->board->height; r++)
-	{
-		for (i32 c = 0; c < g->board->width; c++)
-		{
-			i32 cellX = g->boardDim.x + (c * g->cellWidth);
-			i32 cellY = g->boardDim.y + (r * g->cellHeight);
-
-			SDL_Rect cellBg = {
-				cellX + (0.1 * g->cellWidth),
-				cellY + (0.1 * g->cellHeight),
-				g->cellWidth - (0.2 * g->cellWidth),
-				g->cellHeight - (0.2 * g->cellHeight)
-			};
-			SDL_SetRenderDrawColor(g->renderer, 0, 0, 0, 255);
-			SDL_RenderFillRect(g->renderer, &cellBg);
-		}
-	}
+	// while the generator runs this is its latest snapshot, never the
+	// cells it is writing to
+	const Cell *cells = boardSnapshot(g->board);
 
-	for (i32 r = 0; r < g->board->height; r++)
+	// every snapshot may differ anywhere, and so may the board handed over
+	// after the last one
+	bool generating = g->boardGen || (g->genJob && !genJobDone(g->genJob));
+	if (generating || g->drewSnapshot)
 	{
-		for (i32 c = 0; c < g->board->width; c++)
-		{
-			i32 cellX = g->boardDim.x + (c * g->cellWidth);
-			i32 cellY = g->boardDim.y + (r * g->cellHeight);
-			SDL_Rect cell = {cellX, cellY, g->cellWidth, g->cellHeight};
-			drawPipe(g->renderer, &cell, boardGet(g->board, r, c));
-		}
+		cellTextureTouch(&g->cellTexture, 0, g->boardSize - 1);
+		pipeMeshTouch(&g->pipeMesh, -1);
 	}
+	g->drewSnapshot = generating;
+
+	bool detailed = drawBoard(g->renderer, cells, g->boardSize, g->boardSize,
+	                          &g->camera, &g->cellTexture, &g->pipeMesh,
+	                          &g->palette, g->showGlyphs);
+	if (detailed && g->hasHint)
+		drawHint(g);
 
+	SDL_RenderSetClipRect(g->renderer, NULL);
+	drawTimer(g);
+}
+
+void drawTimer(Game *g)
+{
 	i32 ww, wh;
 	SDL_GetWindowSize(g->window, &ww, &wh);
 	char timerText[15];
 	i32 minutes = (g->gameTimer / 1000) / 60;
 	i32 seconds = (g->gameTimer / 1000) % 60;
 	snprintf(timerText, 15, "%02i:%02i", minutes, seconds);
-	SDL_Color white = {255,255,255,255};
-	SDL_Texture *timerTexture
-	    = createSDLText(g->renderer, timerText, g->font, white);
-	MenuButton *timer = createMenuButton(timerTexture, ww / 2, 10);
-	drawMenuButton(g->renderer, timer);
-	destroyMenuButton(timer);
+
+	// centered on (ww / 2, 10) and dimmed, as the menu buttons are
+	SDL_Color gray = {128, 128, 128, 255};
+	SDL_Point size = textAtlasSize(&g->text, timerText);
+	textAtlasDraw(&g->text, g->renderer, timerText,
+	              ww / 2 - size.x / 2, 10 - size.y / 2, gray);
+}
+
+// H shows the next stretch of a pipe, of the one being drawn if there is
+// one, as far as the solution goes straight
+void playHint(Game *g)
+{
+	i32 preferred = g->piping ? g->selectedColor : -1;
+	traceBegin("hintNext");
+	hintNext(&g->hint, preferred);
+	traceEnd("hintNext");
+}
+
+// the shown part of every hinted pipe, in a lighter shade of its color
+// over the pipes the player drew
+void drawHint(Game *g)
+{
+	Hint *hint = &g->hint;
+	Board *board = g->board;
+	for (i32 pipe = 0; pipe < hint->solver.numPipes; pipe++)
+	{
+		// a pipe's first cell alone shows nothing its endpoint does not
+		if (hint->revealed[pipe] < 2)
+			continue;
+
+		SDL_Color color = paletteColor(&g->palette, pipe);
+		color.r = (color.r + 255) / 2;
+		color.g = (color.g + 255) / 2;
+		color.b = (color.b + 255) / 2;
+
+		pipeMeshDrawPath(&g->hintMesh, g->renderer, &g->camera,
+		                 board->stride, hint->next, hint->solver.start[pipe],
+		                 hint->revealed[pipe], color);
+	}
+}
+
+// F3 toggles the profiler, F4 starts tracing and, once it runs, writes the
+// trace so far, F5 and F6 cycle the generator's move and start ordering
+// for the next board, shown on the profiler's order line
+void playDebugKey(Game *g, SDL_Keycode key)
+{
+	switch (key)
+	{
+		case SDLK_F3:
+			profilerSetEnabled(&g->profiler, !g->profiler.enabled);
+			break;
+		case SDLK_F4:
+			if (SDL_AtomicGet(&traceEnabled))
+				traceDump(TRACE_DUMP_PATH);
+			else
+				traceSetEnabled(true);
+			break;
+		case SDLK_F5:
+			g->genConfig.moveOrder
+			    = (g->genConfig.moveOrder + 1) % MOVEORDER_COUNT;
+			break;
+		case SDLK_F6:
+			g->genConfig.startOrder
+			    = (g->genConfig.startOrder + 1) % STARTORDER_COUNT;
+			break;
+		default:
+			break;
+	}
+}
+
+void drawProfiler(Game *g)
+{
+	Profiler *prof = &g->profiler;
+	SDL_Color white = {255, 255, 255, 255};
+	SDL_Color yellow = {255, 255, 0, 255};
+
+	char lines[PROFPHASE_COUNT + 3][64];
+	i32 numLines = 0;
+	for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+	{
+		snprintf(lines[numLines], 64, "%-8s%6.2f  p50 %6.2f  p99 %6.2f",
+		         profilerPhaseName(i),
+		         profilerLast(prof, i),
+		         profilerPercentile(prof, i, 50.0),
+		         profilerPercentile(prof, i, 99.0));
+		numLines += 1;
+	}
+	// what F5 and F6 set for the next board
+	snprintf(lines[numLines], 64, "order   %s / %s",
+	         boardMoveOrderName(g->genConfig.moveOrder),
+	         boardStartOrderName(g->genConfig.startOrder));
+	numLines += 1;
+	if (g->board->genState != GENSTATE_IDLE)
+	{
+		snprintf(lines[numLines], 64, "gen     %s, %llu nodes, %llu restarts",
+		         boardGenStateName(g->board->genState),
+		         (unsigned long long)g->board->genStats.nodes,
+		         (unsigned long long)g->board->genStats.restarts);
+		numLines += 1;
+	}
+	if (memTracking())
+	{
+		snprintf(lines[numLines], 64,
+		         "alloc   %llu, %llu B, textures +%llu -%llu",
+		         (unsigned long long)g->memFrame.allocs,
+		         (unsigned long long)g->memFrame.bytes,
+		         (unsigned long long)g->memFrame.texturesCreated,
+		         (unsigned long long)g->memFrame.texturesDestroyed);
+		numLines += 1;
+	}
+
+	i32 textWidth = 0;
+	for (i32 i = 0; i < numLines; i++)
+	{
+		SDL_Point size = textAtlasSize(&g->text, lines[i]);
+		if (size.x > textWidth)
+			textWidth = size.x;
+	}
+
+	// frame time graph of the last PROFILER_FRAMES frames, oldest first,
+	// with a line marking the 60 fps budget
+	SDL_Rect graph = {10, 10, PROFILER_FRAMES, 60};
+	f64 msPerPixel = 33.3 / graph.h;
+
+	SDL_SetRenderDrawBlendMode(g->renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(g->renderer, 0, 0, 0, 180);
+	SDL_Rect background = {
+		0,
+		0,
+		(textWidth > graph.w ? textWidth : graph.w) + 20,
+		graph.h + 20 + numLines * 26
+	};
+	SDL_RenderFillRect(g->renderer, &background);
+
+	SDL_SetRenderDrawColor(g->renderer, 0, 255, 0, 255);
+	for (i32 f = 0; f < prof->count; f++)
+	{
+		i32 index = (prof->head + PROFILER_FRAMES - prof->count + f)
+		            % PROFILER_FRAMES;
+		f64 ms = prof->samples[PROFPHASE_FRAME][index]
+		         * 1000.0 / prof->frequency;
+		i32 height = ms / msPerPixel;
+		if (height > graph.h)
+			height = graph.h;
+		SDL_Rect bar = {graph.x + f, graph.y + graph.h - height, 1, height};
+		SDL_RenderFillRect(g->renderer, &bar);
+	}
+	SDL_SetRenderDrawColor(g->renderer, 255, 0, 0, 255);
+	i32 budgetY = graph.y + graph.h - (i32)(16.7 / msPerPixel);
+	SDL_RenderDrawLine(g->renderer, graph.x, budgetY, graph.x + graph.w, budgetY);
+
+	for (i32 i = 0; i < numLines; i++)
+	{
+		textAtlasDraw(&g->text, g->renderer, lines[i], 10, 80 + i * 26,
+		              i < PROFPHASE_COUNT ? white : yellow);
+	}
 }
 
 void playExit(Game *g)
 {
-	free(g->pipeSeq);
+	// leaving halfway, the game can be resumed from the menu
+	if (g->isTimerStarted && !g->finished)
+		playSave(g);
+
+	if (memTracking())
+	{
+		fprintf(stderr, "Play: %llu of %llu frames allocated\n",
+		        (unsigned long long)g->allocFrames,
+		        (unsigned long long)g->playFrames);
+	}
+
+	memFree(g->pipeSeq);
+	paletteFree(&g->palette);
+	cellTextureFree(&g->cellTexture);
+	pipeMeshFree(&g->pipeMesh);
+	pipeMeshFree(&g->hintMesh);
+	if (g->hasHint)
+	{
+		hintFree(&g->hint);
+		g->hasHint = false;
+	}
+
+	// the board may only go once no worker can touch it any more
+	if (g->genJob)
+	{
+		genJobCancel(&g->genPool, g->genJob);
+		genJobFree(g->genJob);
+		g->genJob = NULL;
+	}
+	if (g->boardGen)
+	{
+		boardGenerateEnd(g->boardGen);
+		g->boardGen = NULL;
+	}
 	boardFree(g->board);
 }
 
@@ -982,7 +1469,27 @@ void pauseExit(Game *g)
 
 i32 main(i32 argc, char *argv[])
 {
-	Game game;
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return benchMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--bench-paths") == 0)
+		return benchPathsMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--grade") == 0)
+		return gradeMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+		return serveMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--load") == 0)
+		return serveLoadMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--thumbs") == 0)
+		return thumbMain(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--check") == 0)
+		return checkMain(argc - 2, argv + 2);
+
+	// from the very start, the asset loads included
+	if (argc > 1 && strcmp(argv[1], "--trace") == 0)
+		traceSetEnabled(true);
+	traceThreadName("main");
+
+	Game game = {0};
 	switchState(&game, GAMESTATE_INTRO);
 
 	while (game.running)
@@ -1007,5 +1514,21 @@ i32 main(i32 argc, char *argv[])
 				break;
 		}
 	}
+
+	profilerDump(&game.profiler, PROFILER_DUMP_PATH);
+
+	// closing the window leaves the states as they were, tear them down so
+	// a running generator is stopped and joined
+	switchState(&game, GAMESTATE_EXIT);
+
+	if (SDL_AtomicGet(&traceEnabled))
+		traceDump(TRACE_DUMP_PATH);
+	traceFree();
+
+	if (memTracking())
+	{
+		memReport(stderr);
+		memReportLeaks(stderr);
+	}
 	return 0;
 }
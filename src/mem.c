@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+
+#include "mem.h"
+
+#ifdef FLOW_TRACK_ALLOCS
+
+// call sites the table has room for, the rest are counted under one
+#define MEM_MAX_SITES 1024
+
+// sites listed by memReport
+#define MEM_REPORT_SITES 20
+
+typedef struct
+{
+	const char *file;
+	i32 line;
+	u64 allocs;
+	u64 bytes;
+	i64 liveBlocks;
+	i64 liveBytes;
+} MemSite;
+
+// in front of every block, sized so the block keeps malloc's alignment
+typedef union
+{
+	struct
+	{
+		size_t bytes;
+		i32 site;
+	} info;
+	max_align_t align;
+} MemHeader;
+
+// all under memLock, allocations come from the generator threads too
+static SDL_SpinLock memLock;
+static MemSite memSites[MEM_MAX_SITES];
+static i64 memLiveBlocks;
+static i64 memLiveBytes;
+static i64 memPeakBytes;
+static u64 memAllocs;
+static u64 memBytes;
+static i64 memLiveTextures;
+static u64 memTexturesCreated;
+static u64 memTexturesDestroyed;
+static MemFrame memLastFrame;
+
+// open addressing on file and line, the last slot takes what does not fit
+static i32 memSite(const char *file, i32 line)
+{
+	u64 hash = (u64)(uintptr_t)file * 0x9E3779B97F4A7C15ull + (u64)line;
+	for (i32 probe = 0; probe < MEM_MAX_SITES - 1; probe++)
+	{
+		i32 index = (hash + probe) % (MEM_MAX_SITES - 1);
+		MemSite *site = &memSites[index];
+		if (!site->file)
+		{
+			site->file = file;
+			site->line = line;
+			return index;
+		}
+		if (site->file == file && site->line == line)
+			return index;
+	}
+
+	MemSite *other = &memSites[MEM_MAX_SITES - 1];
+	other->file = "(other)";
+	return MEM_MAX_SITES - 1;
+}
+
+static void* memTrack(MemHeader *header, size_t bytes, const char *file,
+                      i32 line)
+{
+	if (!header)
+		return NULL;
+
+	SDL_AtomicLock(&memLock);
+	i32 index = memSite(file, line);
+	MemSite *site = &memSites[index];
+	site->allocs += 1;
+	site->bytes += bytes;
+	site->liveBlocks += 1;
+	site->liveBytes += bytes;
+	memAllocs += 1;
+	memBytes += bytes;
+	memLiveBlocks += 1;
+	memLiveBytes += bytes;
+	if (memLiveBytes > memPeakBytes)
+		memPeakBytes = memLiveBytes;
+	SDL_AtomicUnlock(&memLock);
+
+	header->info.bytes = bytes;
+	header->info.site = index;
+	return header + 1;
+}
+
+static void memUntrack(MemHeader *header)
+{
+	SDL_AtomicLock(&memLock);
+	MemSite *site = &memSites[header->info.site];
+	site->liveBlocks -= 1;
+	site->liveBytes -= header->info.bytes;
+	memLiveBlocks -= 1;
+	memLiveBytes -= header->info.bytes;
+	SDL_AtomicUnlock(&memLock);
+}
+
+void* memAllocAt(size_t bytes, const char *file, i32 line)
+{
+	return memTrack(malloc(sizeof(MemHeader) + bytes), bytes, file, line);
+}
+
+void* memCallocAt(size_t count, size_t size, const char *file, i32 line)
+{
+	if (size > 0 && count > (SIZE_MAX - sizeof(MemHeader)) / size)
+		return NULL;
+	size_t bytes = count * size;
+	return memTrack(calloc(1, sizeof(MemHeader) + bytes), bytes, file, line);
+}
+
+// a realloc counts as an allocation at its own site, growing arrays show
+// up where they grow
+void* memReallocAt(void *block, size_t bytes, const char *file, i32 line)
+{
+	if (!block)
+		return memAllocAt(bytes, file, line);
+
+	MemHeader *header = (MemHeader*)block - 1;
+	MemHeader old = *header;
+	memUntrack(header);
+	MemHeader *grown = realloc(header, sizeof(MemHeader) + bytes);
+	if (!grown)
+	{
+		// the old block is still there and still counted where it was
+		*header = old;
+		SDL_AtomicLock(&memLock);
+		memSites[old.info.site].liveBlocks += 1;
+		memSites[old.info.site].liveBytes += old.info.bytes;
+		memLiveBlocks += 1;
+		memLiveBytes += old.info.bytes;
+		SDL_AtomicUnlock(&memLock);
+		return NULL;
+	}
+	return memTrack(grown, bytes, file, line);
+}
+
+void memFreeAt(void *block)
+{
+	if (!block)
+		return;
+
+	MemHeader *header = (MemHeader*)block - 1;
+	memUntrack(header);
+	free(header);
+}
+
+SDL_Texture* memTextureAt(SDL_Texture *texture)
+{
+	if (texture)
+	{
+		SDL_AtomicLock(&memLock);
+		memTexturesCreated += 1;
+		memLiveTextures += 1;
+		SDL_AtomicUnlock(&memLock);
+	}
+	return texture;
+}
+
+void memDestroyTexture(SDL_Texture *texture)
+{
+	if (!texture)
+		return;
+
+	SDL_AtomicLock(&memLock);
+	memTexturesDestroyed += 1;
+	memLiveTextures -= 1;
+	SDL_AtomicUnlock(&memLock);
+	SDL_DestroyTexture(texture);
+}
+
+bool memTracking(void)
+{
+	return true;
+}
+
+MemFrame memFrameEnd(void)
+{
+	SDL_AtomicLock(&memLock);
+	MemFrame total = {
+		memAllocs,
+		memBytes,
+		memTexturesCreated,
+		memTexturesDestroyed
+	};
+	SDL_AtomicUnlock(&memLock);
+
+	MemFrame frame = {
+		total.allocs - memLastFrame.allocs,
+		total.bytes - memLastFrame.bytes,
+		total.texturesCreated - memLastFrame.texturesCreated,
+		total.texturesDestroyed - memLastFrame.texturesDestroyed
+	};
+	memLastFrame = total;
+	return frame;
+}
+
+static i32 compareSiteBytes(const void *a, const void *b)
+{
+	const MemSite *x = *(const MemSite* const*)a;
+	const MemSite *y = *(const MemSite* const*)b;
+	return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+// the used sites, sorted by bytes allocated; sites is MEM_MAX_SITES long
+static i32 memSortedSites(const MemSite **sites)
+{
+	i32 count = 0;
+	for (i32 i = 0; i < MEM_MAX_SITES; i++)
+	{
+		if (memSites[i].file)
+			sites[count++] = &memSites[i];
+	}
+	qsort(sites, count, sizeof(MemSite*), compareSiteBytes);
+	return count;
+}
+
+void memReport(FILE *file)
+{
+	static const MemSite *sites[MEM_MAX_SITES];
+
+	SDL_AtomicLock(&memLock);
+	fprintf(file, "Memory: %llu allocations, %.1f KiB in all, peak %.1f KiB, "
+	        "%lli blocks (%.1f KiB) live, %llu of %llu textures destroyed\n",
+	        (unsigned long long)memAllocs, memBytes / 1024.0,
+	        memPeakBytes / 1024.0, (long long)memLiveBlocks,
+	        memLiveBytes / 1024.0, (unsigned long long)memTexturesDestroyed,
+	        (unsigned long long)memTexturesCreated);
+
+	i32 count = memSortedSites(sites);
+	for (i32 i = 0; i < count && i < MEM_REPORT_SITES; i++)
+	{
+		fprintf(file, "  %10llu allocs %12.1f KiB %8lli live  %s:%i\n",
+		        (unsigned long long)sites[i]->allocs, sites[i]->bytes / 1024.0,
+		        (long long)sites[i]->liveBlocks, sites[i]->file,
+		        sites[i]->line);
+	}
+	if (count > MEM_REPORT_SITES)
+		fprintf(file, "  ... and %i more sites\n", count - MEM_REPORT_SITES);
+	SDL_AtomicUnlock(&memLock);
+}
+
+i64 memReportLeaks(FILE *file)
+{
+	static const MemSite *sites[MEM_MAX_SITES];
+
+	SDL_AtomicLock(&memLock);
+	i32 count = memSortedSites(sites);
+	for (i32 i = 0; i < count; i++)
+	{
+		if (sites[i]->liveBlocks == 0)
+			continue;
+		fprintf(file, "Leaked %lli blocks (%lli bytes) allocated at %s:%i\n",
+		        (long long)sites[i]->liveBlocks, (long long)sites[i]->liveBytes,
+		        sites[i]->file, sites[i]->line);
+	}
+	if (memLiveTextures != 0)
+	{
+		fprintf(file, "Leaked %lli textures\n", (long long)memLiveTextures);
+	}
+	i64 leaked = memLiveBlocks;
+	SDL_AtomicUnlock(&memLock);
+	return leaked;
+}
+
+#else
+
+bool memTracking(void)
+{
+	return false;
+}
+
+MemFrame memFrameEnd(void)
+{
+	return (MemFrame){0};
+}
+
+void memReport(FILE *file)
+{
+	(void)file;
+}
+
+i64 memReportLeaks(FILE *file)
+{
+	(void)file;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+
+// Every allocation of the game goes through these. Built with
+// FLOW_TRACK_ALLOCS each one is counted against the file and line it was
+// made on, which costs a lock and a header per block; without it they are
+// the stdlib calls and the report functions say there is nothing to tell.
+#define memAlloc(bytes) memAllocAt((bytes), __FILE__, __LINE__)
+#define memCalloc(count, size) memCallocAt((count), (size), __FILE__, __LINE__)
+#define memRealloc(block, bytes) memReallocAt((block), (bytes), __FILE__, __LINE__)
+#define memFree(block) memFreeAt(block)
+
+// SDL textures are counted the same way: memTexture wraps the call that
+// created one, memDestroyTexture replaces SDL_DestroyTexture
+#define memTexture(texture) memTextureAt((texture))
+
+// what happened since the last memFrameEnd
+typedef struct
+{
+	u64 allocs;
+	u64 bytes;
+	u64 texturesCreated;
+	u64 texturesDestroyed;
+} MemFrame;
+
+#ifdef FLOW_TRACK_ALLOCS
+
+void* memAllocAt(size_t bytes, const char *file, i32 line);
+void* memCallocAt(size_t count, size_t size, const char *file, i32 line);
+void* memReallocAt(void *block, size_t bytes, const char *file, i32 line);
+void memFreeAt(void *block);
+
+SDL_Texture* memTextureAt(SDL_Texture *texture);
+void memDestroyTexture(SDL_Texture *texture);
+
+#else
+
+static inline void* memAllocAt(size_t bytes, const char *file, i32 line)
+{
+	(void)file;
+	(void)line;
+	return malloc(bytes);
+}
+
+static inline void* memCallocAt(size_t count, size_t size, const char *file,
+                                i32 line)
+{
+	(void)file;
+	(void)line;
+	return calloc(count, size);
+}
+
+static inline void* memReallocAt(void *block, size_t bytes, const char *file,
+                                 i32 line)
+{
+	(void)file;
+	(void)line;
+	return realloc(block, bytes);
+}
+
+static inline void memFreeAt(void *block)
+{
+	free(block);
+}
+
+static inline SDL_Texture* memTextureAt(SDL_Texture *texture)
+{
+	return texture;
+}
+
+static inline void memDestroyTexture(SDL_Texture *texture)
+{
+	SDL_DestroyTexture(texture);
+}
+
+#endif
+
+// false without FLOW_TRACK_ALLOCS, when every count stays 0
+bool memTracking(void);
+
+MemFrame memFrameEnd(void);
+
+// every call site by bytes allocated, with the peak and current use
+void memReport(FILE *file);
+
+// call sites with blocks or textures still alive, returns how many blocks
+i64 memReportLeaks(FILE *file);
+
+#endif
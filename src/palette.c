@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "palette.h"
+#include "mem.h"
+
+#define GOLDEN_ANGLE 137.508
+#define LIGHTNESS_STEPS 3
+
+static const SDL_Color classicColors[] = {
+	{255,   0,   0, 255}, // red
+	{  0, 255,   0, 255}, // green
+	{  0,   0, 255, 255}, // blue
+	{255, 255,   0, 255}, // yellow
+	{125,   0, 255, 255}, // purple
+	{  0, 255, 255, 255}, // cyan
+	{255, 255, 255, 255}, // white
+	{211, 211, 211, 255}, // light gray
+	{128, 128, 128, 255}, // medium gray
+	{169, 169, 169, 255}, // dark gray
+	{255,   0, 255, 255}, // magenta
+	{255, 192, 203, 255}, // pink
+	{139,   0,   0, 255}, // dark red
+	{  0, 100,   0, 255}, // dark green
+	{  0,   0, 139, 255}  // dark blue
+};
+
+#define NUM_CLASSIC_COLORS (i32)(sizeof(classicColors) / sizeof(classicColors[0]))
+
+static f64 hueToChannel(f64 p, f64 q, f64 t)
+{
+	if (t < 0.0)
+		t += 1.0;
+	if (t > 1.0)
+		t -= 1.0;
+	if (t < 1.0 / 6.0)
+		return p + (q - p) * 6.0 * t;
+	if (t < 1.0 / 2.0)
+		return q;
+	if (t < 2.0 / 3.0)
+		return p + (q - p) * (2.0 / 3.0 - t) * 6.0;
+	return p;
+}
+
+static SDL_Color hslToColor(f64 h, f64 s, f64 l)
+{
+	f64 q = l < 0.5 ? l * (1.0 + s) : l + s - l * s;
+	f64 p = 2.0 * l - q;
+	return (SDL_Color){
+		(u8)(hueToChannel(p, q, h + 1.0 / 3.0) * 255.0 + 0.5),
+		(u8)(hueToChannel(p, q, h) * 255.0 + 0.5),
+		(u8)(hueToChannel(p, q, h - 1.0 / 3.0) * 255.0 + 0.5),
+		255
+	};
+}
+
+bool paletteInit(Palette *palette, i32 count)
+{
+	if (count < 1)
+		count = 1;
+
+	palette->colors = memAlloc(sizeof(SDL_Color) * count);
+	if (!palette->colors)
+	{
+		fprintf(stderr, "Failed to allocate a palette of %i colors\n", count);
+		palette->count = 0;
+		return false;
+	}
+	palette->count = count;
+
+	// the golden angle never repeats a hue, and every run of LIGHTNESS_STEPS
+	// neighbours gets a different lightness on top
+	static const f64 lightness[LIGHTNESS_STEPS] = {0.55, 0.38, 0.72};
+	f64 hue = 0.0;
+	for (i32 i = 0; i < count; i++)
+	{
+		if (i < NUM_CLASSIC_COLORS)
+		{
+			palette->colors[i] = classicColors[i];
+			continue;
+		}
+
+		i32 k = i - NUM_CLASSIC_COLORS;
+		palette->colors[i] = hslToColor(hue / 360.0, 0.85,
+		                                lightness[k % LIGHTNESS_STEPS]);
+		hue += GOLDEN_ANGLE;
+		if (hue >= 360.0)
+			hue -= 360.0;
+	}
+	return true;
+}
+
+void paletteFree(Palette *palette)
+{
+	memFree(palette->colors);
+	palette->colors = NULL;
+	palette->count = 0;
+}
+
+Glyph paletteGlyph(CellColor color)
+{
+	// the classic colors are far enough apart on their own
+	if (color < NUM_CLASSIC_COLORS)
+		return GLYPH_NONE;
+	return GLYPH_DOT + (color - NUM_CLASSIC_COLORS) % (GLYPH_COUNT - 1);
+}
@@ -0,0 +1,41 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+
+// small marks drawn on pipe ends, so colors that end up close to each
+// other on boards with hundreds of pipes can still be told apart
+typedef enum
+{
+	GLYPH_NONE,
+	GLYPH_DOT,
+	GLYPH_HBAR,
+	GLYPH_VBAR,
+	GLYPH_CROSS,
+	GLYPH_RING,
+	GLYPH_COUNT
+} Glyph;
+
+// colors for pipe indices 0 to count - 1: the classic hand picked ones
+// first, then hues spaced by the golden angle with a few lightness steps
+typedef struct
+{
+	SDL_Color *colors;
+	i32 count;
+} Palette;
+
+bool paletteInit(Palette *palette, i32 count);
+
+void paletteFree(Palette *palette);
+
+Glyph paletteGlyph(CellColor color);
+
+static inline SDL_Color paletteColor(Palette *palette, CellColor color)
+{
+	return palette->colors[color % palette->count];
+}
+
+#endif
@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "pipemesh.h"
+#include "mem.h"
+
+#define PIPEMESH_PI 3.14159265358979f
+
+// unit circles for pipe ends and joints, filled in by pipeMeshInit
+static f32 endCircle[PIPEMESH_END_SEGMENTS][2];
+static f32 jointCircle[PIPEMESH_JOINT_SEGMENTS][2];
+
+// a step from a cell's center to its neighbour's for every CellConnection
+static const f32 connectionStep[4][2] = {
+	{ 0.0f, -1.0f},
+	{ 0.0f,  1.0f},
+	{-1.0f,  0.0f},
+	{ 1.0f,  0.0f}
+};
+
+// doubles capacity until count more fit, arrays only ever grow
+static void* pipeMeshReserve(void *array, i32 *capacity, i32 needed,
+                             size_t size)
+{
+	if (needed <= *capacity)
+		return array;
+
+	i32 grown = *capacity > 0 ? *capacity : 64;
+	while (grown < needed)
+		grown *= 2;
+	*capacity = grown;
+	return memRealloc(array, size * grown);
+}
+
+static void pipeMeshCircle(PipeMeshPart *part, f32 x, f32 y, f32 radius,
+                           f32 (*circle)[2], i32 segments)
+{
+	part->points = pipeMeshReserve(part->points, &part->pointCapacity,
+	                               part->numPoints + segments + 1,
+	                               sizeof(PipeMeshPoint));
+	part->indices = pipeMeshReserve(part->indices, &part->indexCapacity,
+	                                part->numIndices + segments * 3,
+	                                sizeof(i32));
+
+	i32 center = part->numPoints;
+	part->points[part->numPoints++] = (PipeMeshPoint){x, y, 0.0f, 0.0f};
+	for (i32 i = 0; i < segments; i++)
+	{
+		part->points[part->numPoints++] = (PipeMeshPoint){
+			x, y, circle[i][0] * radius, circle[i][1] * radius
+		};
+		part->indices[part->numIndices++] = center;
+		part->indices[part->numIndices++] = center + 1 + i;
+		part->indices[part->numIndices++] = center + 1 + (i + 1) % segments;
+	}
+}
+
+// a segment from the center of one cell to the center of the next, as
+// wide as PIPEMESH_WIDTH
+static void pipeMeshSegment(PipeMeshPart *part, f32 x, f32 y,
+                            CellConnection connection)
+{
+	part->points = pipeMeshReserve(part->points, &part->pointCapacity,
+	                               part->numPoints + 4,
+	                               sizeof(PipeMeshPoint));
+	part->indices = pipeMeshReserve(part->indices, &part->indexCapacity,
+	                                part->numIndices + 6, sizeof(i32));
+
+	f32 stepX = connectionStep[connection][0];
+	f32 stepY = connectionStep[connection][1];
+	f32 sideX = -stepY * PIPEMESH_WIDTH / 2.0f;
+	f32 sideY = stepX * PIPEMESH_WIDTH / 2.0f;
+
+	i32 first = part->numPoints;
+	PipeMeshPoint *p = &part->points[first];
+	p[0] = (PipeMeshPoint){x, y, sideX, sideY};
+	p[1] = (PipeMeshPoint){x, y, -sideX, -sideY};
+	p[2] = (PipeMeshPoint){x + stepX, y + stepY, sideX, sideY};
+	p[3] = (PipeMeshPoint){x + stepX, y + stepY, -sideX, -sideY};
+	part->numPoints += 4;
+
+	i32 *index = &part->indices[part->numIndices];
+	index[0] = first;
+	index[1] = first + 1;
+	index[2] = first + 2;
+	index[3] = first + 1;
+	index[4] = first + 3;
+	index[5] = first + 2;
+	part->numIndices += 6;
+}
+
+bool pipeMeshInit(PipeMesh *mesh, i32 numPipes)
+{
+	*mesh = (PipeMesh){0};
+	mesh->parts = memCalloc(numPipes, sizeof(PipeMeshPart));
+	if (!mesh->parts)
+		return false;
+	mesh->numParts = numPipes;
+	pipeMeshTouch(mesh, -1);
+
+	for (i32 i = 0; i < PIPEMESH_END_SEGMENTS; i++)
+	{
+		f32 angle = 2.0f * PIPEMESH_PI * i / PIPEMESH_END_SEGMENTS;
+		endCircle[i][0] = cosf(angle);
+		endCircle[i][1] = sinf(angle);
+	}
+	for (i32 i = 0; i < PIPEMESH_JOINT_SEGMENTS; i++)
+	{
+		f32 angle = 2.0f * PIPEMESH_PI * i / PIPEMESH_JOINT_SEGMENTS;
+		jointCircle[i][0] = cosf(angle);
+		jointCircle[i][1] = sinf(angle);
+	}
+	return true;
+}
+
+void pipeMeshFree(PipeMesh *mesh)
+{
+	for (i32 i = 0; i < mesh->numParts; i++)
+	{
+		memFree(mesh->parts[i].points);
+		memFree(mesh->parts[i].indices);
+	}
+	memFree(mesh->parts);
+	memFree(mesh->vertices);
+	memFree(mesh->indices);
+	*mesh = (PipeMesh){0};
+}
+
+void pipeMeshTouch(PipeMesh *mesh, i32 color)
+{
+	if (mesh->numParts == 0)
+		return;
+
+	if (color < 0)
+	{
+		// a new board, or one changed anywhere, may have its ends anywhere
+		for (i32 i = 0; i < mesh->numParts; i++)
+		{
+			mesh->parts[i].dirty = true;
+			mesh->parts[i].ends[0] = -1;
+			mesh->parts[i].ends[1] = -1;
+		}
+	}
+	else
+	{
+		mesh->parts[color % mesh->numParts].dirty = true;
+	}
+	mesh->anyDirty = true;
+}
+
+static bool pipeMeshIsEnd(const Cell *cell)
+{
+	return cell->state == CELLSTATE_PIPE_START
+	       || cell->state == CELLSTATE_PIPE_END;
+}
+
+static void pipeMeshCover(PipeMeshPart *part, i32 r, i32 c)
+{
+	if (r < part->top)
+		part->top = r;
+	if (r > part->bottom)
+		part->bottom = r;
+	if (c < part->left)
+		part->left = c;
+	if (c > part->right)
+		part->right = c;
+}
+
+// the triangles of one cell of a pipe, at row r and column c
+static void pipeMeshCell(PipeMeshPart *part, const Cell *cell, i32 r, i32 c)
+{
+	f32 x = c + 0.5f;
+	f32 y = r + 0.5f;
+	if (pipeMeshIsEnd(cell))
+	{
+		pipeMeshCircle(part, x, y, PIPEMESH_END_RADIUS,
+		               endCircle, PIPEMESH_END_SEGMENTS);
+	}
+	else
+	{
+		// rounds off the corners, and the end of a pipe being drawn
+		pipeMeshCircle(part, x, y, PIPEMESH_WIDTH / 2.0f,
+		               jointCircle, PIPEMESH_JOINT_SEGMENTS);
+	}
+
+	pipeMeshCover(part, r, c);
+	if (cell->connection < CELLCONNECTION_NONE)
+	{
+		pipeMeshSegment(part, x, y, cell->connection);
+		// the segment reaches into the next cell, so that one is covered too
+		pipeMeshCover(part, r + (i32)connectionStep[cell->connection][1],
+		              c + (i32)connectionStep[cell->connection][0]);
+	}
+}
+
+// Lays the cells of part's pipe from the end at index along their
+// connections, the way the player draws them, up to the cell at stop.
+// Returns the last one laid.
+static i32 pipeMeshFollow(PipeMeshPart *part, const Cell *cells, i32 width,
+                          i32 height, i32 index, i32 stop, i32 numParts)
+{
+	i32 stride = width + 2;
+	i32 delta[4] = {-stride, stride, -1, 1};
+	i32 pipe = cells[index].color % numParts;
+
+	// a pipe is never longer than the board, whatever the connections say
+	for (i32 steps = 0; steps < width * height; steps++)
+	{
+		const Cell *cell = &cells[index];
+		pipeMeshCell(part, cell, index / stride - 1, index % stride - 1);
+		if (cell->connection >= CELLCONNECTION_NONE)
+			break;
+
+		// the ring of walls around the board keeps this on it
+		const Cell *next = &cells[index + delta[cell->connection]];
+		if (   index + delta[cell->connection] == stop
+		    || (!pipeMeshIsEnd(next) && next->state != CELLSTATE_PIPE)
+		    || next->color % numParts != pipe)
+		{
+			break;
+		}
+		index += delta[cell->connection];
+	}
+	return index;
+}
+
+// whether part's ends are still the ends of its pipe
+static bool pipeMeshEndsKnown(PipeMeshPart *part, i32 pipe, const Cell *cells,
+                              i32 numParts)
+{
+	for (i32 k = 0; k < 2; k++)
+	{
+		if (   part->ends[k] < 0
+		    || !pipeMeshIsEnd(&cells[part->ends[k]])
+		    || cells[part->ends[k]].color % numParts != pipe)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Builds every touched pipe: from its ends when they are known, in one
+// pass over the board for those whose ends are not.
+static void pipeMeshBuild(PipeMesh *mesh, const Cell *cells,
+                          i32 width, i32 height)
+{
+	mesh->rebuilt = 0;
+	bool scan = false;
+	for (i32 i = 0; i < mesh->numParts; i++)
+	{
+		PipeMeshPart *part = &mesh->parts[i];
+		if (!part->dirty)
+			continue;
+
+		part->numPoints = 0;
+		part->numIndices = 0;
+		part->top = height;
+		part->bottom = -1;
+		part->left = width;
+		part->right = -1;
+		mesh->rebuilt += 1;
+
+		if (!pipeMeshEndsKnown(part, i, cells, mesh->numParts))
+		{
+			part->ends[0] = -1;
+			part->ends[1] = -1;
+			scan = true;
+			continue;
+		}
+
+		// drawn from either end, and the player may have drawn it from
+		// the second into the first
+		i32 last = pipeMeshFollow(part, cells, width, height, part->ends[0],
+		                          -1, mesh->numParts);
+		if (last != part->ends[1])
+		{
+			pipeMeshFollow(part, cells, width, height, part->ends[1],
+			               part->ends[0], mesh->numParts);
+		}
+		part->dirty = false;
+	}
+	if (!scan)
+		return;
+
+	i32 stride = width + 2;
+	for (i32 r = 0; r < height; r++)
+	{
+		const Cell *cell = &cells[(r + 1) * stride + 1];
+		for (i32 c = 0; c < width; c++, cell++)
+		{
+			bool end = pipeMeshIsEnd(cell);
+			if (!end && cell->state != CELLSTATE_PIPE)
+				continue;
+
+			PipeMeshPart *part = &mesh->parts[cell->color % mesh->numParts];
+			if (!part->dirty)
+				continue;
+
+			if (end)
+			{
+				i32 k = part->ends[0] < 0 ? 0 : 1;
+				part->ends[k] = (r + 1) * stride + c + 1;
+			}
+			pipeMeshCell(part, cell, r, c);
+		}
+	}
+
+	for (i32 i = 0; i < mesh->numParts; i++)
+		mesh->parts[i].dirty = false;
+}
+
+static bool pipeMeshInView(PipeMeshPart *part, SDL_Rect *visible)
+{
+	return part->numPoints > 0
+	       && part->right >= visible->x
+	       && part->left < visible->x + visible->w
+	       && part->bottom >= visible->y
+	       && part->top < visible->y + visible->h;
+}
+
+// adds part's triangles to the batch where the camera shows them, the
+// batch must have room for them
+static void pipeMeshAppend(PipeMesh *mesh, PipeMeshPart *part,
+                           const Camera *camera, SDL_Color color)
+{
+	f32 size = camera->cellWidth < camera->cellHeight
+	           ? camera->cellWidth
+	           : camera->cellHeight;
+	i32 base = mesh->numVertices;
+	for (i32 k = 0; k < part->numPoints; k++)
+	{
+		PipeMeshPoint *p = &part->points[k];
+		mesh->vertices[mesh->numVertices++] = (SDL_Vertex){
+			.position = {
+				camera->x + p->x * camera->cellWidth + p->dx * size,
+				camera->y + p->y * camera->cellHeight + p->dy * size
+			},
+			.color = color
+		};
+	}
+	for (i32 k = 0; k < part->numIndices; k++)
+		mesh->indices[mesh->numIndices++] = base + part->indices[k];
+}
+
+// puts the triangles of every pipe in view where the camera shows them
+static void pipeMeshPlace(PipeMesh *mesh, const Camera *camera,
+                          SDL_Rect visible, Palette *palette)
+{
+	i32 numVertices = 0;
+	i32 numIndices = 0;
+	for (i32 i = 0; i < mesh->numParts; i++)
+	{
+		if (!pipeMeshInView(&mesh->parts[i], &visible))
+			continue;
+		numVertices += mesh->parts[i].numPoints;
+		numIndices += mesh->parts[i].numIndices;
+	}
+	mesh->vertices = pipeMeshReserve(mesh->vertices, &mesh->vertexCapacity,
+	                                 numVertices, sizeof(SDL_Vertex));
+	mesh->indices = pipeMeshReserve(mesh->indices, &mesh->indexCapacity,
+	                                numIndices, sizeof(i32));
+
+	mesh->numVertices = 0;
+	mesh->numIndices = 0;
+	for (i32 i = 0; i < mesh->numParts; i++)
+	{
+		PipeMeshPart *part = &mesh->parts[i];
+		if (pipeMeshInView(part, &visible))
+			pipeMeshAppend(mesh, part, camera, paletteColor(palette, i));
+	}
+	mesh->camera = *camera;
+	mesh->visible = visible;
+}
+
+void pipeMeshDraw(PipeMesh *mesh, SDL_Renderer *renderer, const Cell *cells,
+                  i32 width, i32 height, const Camera *camera,
+                  Palette *palette)
+{
+	SDL_Rect visible = cameraVisibleCells(camera);
+	bool moved = mesh->camera.x != camera->x
+	             || mesh->camera.y != camera->y
+	             || mesh->camera.cellWidth != camera->cellWidth
+	             || mesh->camera.cellHeight != camera->cellHeight
+	             || mesh->visible.x != visible.x
+	             || mesh->visible.y != visible.y
+	             || mesh->visible.w != visible.w
+	             || mesh->visible.h != visible.h;
+
+	if (mesh->anyDirty)
+		pipeMeshBuild(mesh, cells, width, height);
+	if (mesh->anyDirty || moved)
+		pipeMeshPlace(mesh, camera, visible, palette);
+	mesh->anyDirty = false;
+
+	if (mesh->numIndices > 0)
+	{
+		SDL_RenderGeometry(renderer, NULL, mesh->vertices, mesh->numVertices,
+		                   mesh->indices, mesh->numIndices);
+	}
+}
+
+void pipeMeshDrawPath(PipeMesh *mesh, SDL_Renderer *renderer,
+                      const Camera *camera, i32 stride, const i32 *next,
+                      i32 start, i32 count, SDL_Color color)
+{
+	if (mesh->numParts == 0 || count < 1)
+		return;
+
+	PipeMeshPart *part = &mesh->parts[0];
+	part->numPoints = 0;
+	part->numIndices = 0;
+	i32 cell = start;
+	for (i32 i = 0; i < count; i++)
+	{
+		f32 x = cell % stride - 1 + 0.5f;
+		f32 y = cell / stride - 1 + 0.5f;
+		pipeMeshCircle(part, x, y, PIPEMESH_WIDTH / 2.0f,
+		               jointCircle, PIPEMESH_JOINT_SEGMENTS);
+		if (i + 1 < count)
+		{
+			i32 step = next[cell] - cell;
+			CellConnection connection = step == -stride ? CELLCONNECTION_UP
+			                          : step == stride  ? CELLCONNECTION_DOWN
+			                          : step == -1      ? CELLCONNECTION_LEFT
+			                                            : CELLCONNECTION_RIGHT;
+			pipeMeshSegment(part, x, y, connection);
+			cell = next[cell];
+		}
+	}
+
+	mesh->vertices = pipeMeshReserve(mesh->vertices, &mesh->vertexCapacity,
+	                                 part->numPoints, sizeof(SDL_Vertex));
+	mesh->indices = pipeMeshReserve(mesh->indices, &mesh->indexCapacity,
+	                                part->numIndices, sizeof(i32));
+	mesh->numVertices = 0;
+	mesh->numIndices = 0;
+	pipeMeshAppend(mesh, part, camera, color);
+	SDL_RenderGeometry(renderer, NULL, mesh->vertices, mesh->numVertices,
+	                   mesh->indices, mesh->numIndices);
+}
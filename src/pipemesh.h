@@ -0,0 +1,96 @@
+#ifndef PIPEMESH_H
+#define PIPEMESH_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+#include "camera.h"
+#include "palette.h"
+
+// sizes relative to the smaller side of a cell
+#define PIPEMESH_WIDTH 0.3f
+#define PIPEMESH_END_RADIUS 0.3f
+
+// triangles in the circle of a pipe end and of a joint between segments
+#define PIPEMESH_END_SEGMENTS 24
+#define PIPEMESH_JOINT_SEGMENTS 12
+
+// A point of a pipe's triangles: a cell position plus an offset in cells
+// of the smaller side, so circles stay round on cells that are not square.
+typedef struct
+{
+	f32 x;
+	f32 y;
+	f32 dx;
+	f32 dy;
+} PipeMeshPoint;
+
+// The triangles of one pipe, kept until the pipe changes, and the rows
+// and columns they cover.
+typedef struct
+{
+	PipeMeshPoint *points;
+	i32 numPoints;
+	i32 pointCapacity;
+	i32 *indices;
+	i32 numIndices;
+	i32 indexCapacity;
+	i32 top;
+	i32 bottom;
+	i32 left;
+	i32 right;
+
+	// the padded indices of the pipe's two end cells, -1 until a pass
+	// over the board found them
+	i32 ends[2];
+	bool dirty;
+} PipeMeshPart;
+
+// Every pipe in view as one batch of triangles, drawn with a single
+// SDL_RenderGeometry. A pipe's triangles are only built again once it is
+// touched, following its connections from its ends rather than going over
+// the board, and the batch only moves to the window again when a pipe or
+// the camera did. Pipes wholly out of cameraVisibleCells are left out.
+typedef struct
+{
+	PipeMeshPart *parts;
+	i32 numParts;
+	bool anyDirty;
+
+	SDL_Vertex *vertices;
+	i32 numVertices;
+	i32 vertexCapacity;
+	i32 *indices;
+	i32 numIndices;
+	i32 indexCapacity;
+	Camera camera;
+	SDL_Rect visible;
+
+	// pipes built again for the last batch
+	i32 rebuilt;
+} PipeMesh;
+
+// numPipes is the number of colors the board may use
+bool pipeMeshInit(PipeMesh *mesh, i32 numPipes);
+
+void pipeMeshFree(PipeMesh *mesh);
+
+// The pipe of color changed, or with color -1 every pipe did. The ends of
+// a pipe must stay where they are until every pipe is touched.
+void pipeMeshTouch(PipeMesh *mesh, i32 color);
+
+// builds what was touched from cells, padded like Board cells, and draws
+// the pipes in view
+void pipeMeshDraw(PipeMesh *mesh, SDL_Renderer *renderer, const Cell *cells,
+                  i32 width, i32 height, const Camera *camera,
+                  Palette *palette);
+
+// Draws count cells as a pipe in color, from the padded index start on,
+// each followed by next[cell] on a board stride cells wide. Nothing is
+// kept: mesh is only scratch, use one that pipeMeshDraw does not.
+void pipeMeshDrawPath(PipeMesh *mesh, SDL_Renderer *renderer,
+                      const Camera *camera, i32 stride, const i32 *next,
+                      i32 start, i32 count, SDL_Color color);
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "profiler.h"
+
+void profilerInit(Profiler *p)
+{
+	memset(p, 0, sizeof(Profiler));
+	p->frequency = SDL_GetPerformanceFrequency();
+}
+
+void profilerSetEnabled(Profiler *p, bool enabled)
+{
+	// Switched on halfway through a phase, as F3 is while input is
+	// handled, the phase ends before it was begun; it counts from now
+	// instead of from whenever the profiler was last on.
+	u64 now = enabled ? SDL_GetPerformanceCounter() : 0;
+	p->enabled = enabled;
+	for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+	{
+		p->current[i] = 0;
+		p->phaseStart[i] = now;
+	}
+
+	// the first frame after switching on has no valid start point
+	p->lastFrameEnd = now;
+}
+
+void profilerFrameEnd(Profiler *p)
+{
+	if (!p->enabled)
+		return;
+
+	u64 now = SDL_GetPerformanceCounter();
+	p->current[PROFPHASE_FRAME] = now - p->lastFrameEnd;
+	p->lastFrameEnd = now;
+
+	for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+	{
+		p->samples[i][p->head] = p->current[i];
+
+		u64 us = p->current[i] * 1000000 / p->frequency;
+		u64 bucket = us / PROFILER_BUCKET_US;
+		if (bucket >= PROFILER_BUCKETS)
+			bucket = PROFILER_BUCKETS - 1;
+		p->histogram[i][bucket] += 1;
+
+		p->current[i] = 0;
+	}
+
+	p->head = (p->head + 1) % PROFILER_FRAMES;
+	if (p->count < PROFILER_FRAMES)
+		p->count += 1;
+	p->totalFrames += 1;
+}
+
+static i32 compareU64(const void *a, const void *b)
+{
+	u64 x = *(const u64*)a;
+	u64 y = *(const u64*)b;
+	return (x > y) - (x < y);
+}
+
+f64 profilerPercentile(Profiler *p, ProfPhase phase, f64 percentile)
+{
+	if (p->count == 0)
+		return 0.0;
+
+	u64 sorted[PROFILER_FRAMES];
+	memcpy(sorted, p->samples[phase], sizeof(u64) * p->count);
+	qsort(sorted, p->count, sizeof(u64), compareU64);
+
+	i32 index = (i32)(percentile / 100.0 * (p->count - 1) + 0.5);
+	return sorted[index] * 1000.0 / p->frequency;
+}
+
+f64 profilerLast(Profiler *p, ProfPhase phase)
+{
+	if (p->count == 0)
+		return 0.0;
+
+	i32 last = (p->head + PROFILER_FRAMES - 1) % PROFILER_FRAMES;
+	return p->samples[phase][last] * 1000.0 / p->frequency;
+}
+
+const char* profilerPhaseName(ProfPhase phase)
+{
+	switch (phase)
+	{
+		case PROFPHASE_FRAME:
+			return "frame";
+		case PROFPHASE_INPUT:
+			return "input";
+		case PROFPHASE_DRAW:
+			return "draw";
+		case PROFPHASE_PRESENT:
+			return "present";
+		default:
+			return "unknown";
+	}
+}
+
+// percentile of the whole session, read back from the histogram, so the
+// result is only as precise as PROFILER_BUCKET_US
+static f64 histogramPercentile(Profiler *p, ProfPhase phase, f64 percentile)
+{
+	u64 target = (u64)(percentile / 100.0 * p->totalFrames);
+	u64 seen = 0;
+	for (i32 b = 0; b < PROFILER_BUCKETS; b++)
+	{
+		seen += p->histogram[phase][b];
+		if (seen > target)
+			return (b + 1) * PROFILER_BUCKET_US / 1000.0;
+	}
+	return PROFILER_BUCKETS * PROFILER_BUCKET_US / 1000.0;
+}
+
+bool profilerDump(Profiler *p, const char *path)
+{
+	if (p->totalFrames == 0)
+		return true;
+
+	FILE *file = fopen(path, "w");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s for writing\n", path);
+		return false;
+	}
+
+	fprintf(file, "# frames: %llu\n", (unsigned long long)p->totalFrames);
+	for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+	{
+		fprintf(file, "# %s: p50 <= %.2f ms, p99 <= %.2f ms\n",
+		        profilerPhaseName(i),
+		        histogramPercentile(p, i, 50.0),
+		        histogramPercentile(p, i, 99.0));
+	}
+
+	fprintf(file, "bucket_ms");
+	for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+		fprintf(file, ",%s", profilerPhaseName(i));
+	fprintf(file, "\n");
+
+	for (i32 b = 0; b < PROFILER_BUCKETS; b++)
+	{
+		bool empty = true;
+		for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+		{
+			if (p->histogram[i][b] != 0)
+				empty = false;
+		}
+		if (empty)
+			continue;
+
+		fprintf(file, "%.2f", b * PROFILER_BUCKET_US / 1000.0);
+		for (i32 i = 0; i < PROFPHASE_COUNT; i++)
+			fprintf(file, ",%llu", (unsigned long long)p->histogram[i][b]);
+		fprintf(file, "\n");
+	}
+
+	fclose(file);
+	printf("Frame-time histogram written to %s\n", path);
+	return true;
+}
@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+
+// number of frames kept for the rolling p50/p99
+#define PROFILER_FRAMES 240
+
+// session histogram: PROFILER_BUCKETS buckets of PROFILER_BUCKET_US each,
+// the last bucket collects everything slower
+#define PROFILER_BUCKETS 200
+#define PROFILER_BUCKET_US 250
+
+#define PROFILER_DUMP_PATH "frametimes.csv"
+
+typedef enum
+{
+	PROFPHASE_FRAME,
+	PROFPHASE_INPUT,
+	PROFPHASE_DRAW,
+	PROFPHASE_PRESENT,
+	PROFPHASE_COUNT
+} ProfPhase;
+
+typedef struct
+{
+	bool enabled;
+	u64 frequency;
+	u64 lastFrameEnd;
+	u64 phaseStart[PROFPHASE_COUNT];
+	u64 current[PROFPHASE_COUNT];
+	u64 samples[PROFPHASE_COUNT][PROFILER_FRAMES];
+	i32 head;
+	i32 count;
+	u64 histogram[PROFPHASE_COUNT][PROFILER_BUCKETS];
+	u64 totalFrames;
+} Profiler;
+
+void profilerInit(Profiler *p);
+
+void profilerSetEnabled(Profiler *p, bool enabled);
+
+void profilerFrameEnd(Profiler *p);
+
+f64 profilerPercentile(Profiler *p, ProfPhase phase, f64 percentile);
+
+f64 profilerLast(Profiler *p, ProfPhase phase);
+
+const char* profilerPhaseName(ProfPhase phase);
+
+bool profilerDump(Profiler *p, const char *path);
+
+// these wrap every phase of the frame, so when the profiler is off they
+// must stay a single predictable branch
+static inline void profilerBegin(Profiler *p, ProfPhase phase)
+{
+	if (p->enabled)
+		p->phaseStart[phase] = SDL_GetPerformanceCounter();
+}
+
+static inline void profilerEnd(Profiler *p, ProfPhase phase)
+{
+	if (p->enabled)
+		p->current[phase] += SDL_GetPerformanceCounter() - p->phaseStart[phase];
+}
+
+#endif
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "save.h"
+#include "mem.h"
+
+// Layout, all little endian:
+//   "FLOW", u16 version, u16 width, u16 height, u16 numColors, u64 seed,
+//   u64 gameTimer, u8 flags, u8 endPoint, u16 selectedColor,
+//   u32 pipeSeqSize,
+//   per cell row by row: u8 state | connection << 4, u16 color,
+//   per pipeSeq cell: u16 x, u16 y,
+//   u32 FNV-1a of everything before it.
+#define SAVE_MAGIC "FLOW"
+#define SAVE_HEADER_SIZE 36
+#define SAVE_CELL_SIZE 3
+#define SAVE_SEQ_SIZE 4
+#define SAVE_CHECK_SIZE 4
+
+#define SAVE_FLAG_TIMER_STARTED 1
+#define SAVE_FLAG_PIPING 2
+
+#define SAVE_FNV_BASIS 2166136261u
+#define SAVE_FNV_PRIME 16777619u
+
+// bytes gathered before each fwrite
+#define SAVE_CHUNK 4096
+
+typedef struct
+{
+	FILE *file;
+	u8 chunk[SAVE_CHUNK];
+	u32 used;
+	u32 hash;
+	bool failed;
+} SaveWriter;
+
+typedef struct
+{
+	const u8 *data;
+	size_t size;
+	size_t pos;
+	u32 hash;
+	bool failed;
+} SaveReader;
+
+static void saveFlush(SaveWriter *writer)
+{
+	if (   writer->used > 0
+	    && fwrite(writer->chunk, 1, writer->used, writer->file) != writer->used)
+	{
+		writer->failed = true;
+	}
+	writer->used = 0;
+}
+
+static void savePut(SaveWriter *writer, u64 value, i32 bytes)
+{
+	for (i32 i = 0; i < bytes; i++)
+	{
+		if (writer->used == SAVE_CHUNK)
+			saveFlush(writer);
+		u8 byte = (u8)(value >> (8 * i));
+		writer->hash = (writer->hash ^ byte) * SAVE_FNV_PRIME;
+		writer->chunk[writer->used++] = byte;
+	}
+}
+
+static u64 saveGet(SaveReader *reader, i32 bytes)
+{
+	if (reader->pos + bytes > reader->size)
+	{
+		reader->failed = true;
+		return 0;
+	}
+
+	u64 value = 0;
+	for (i32 i = 0; i < bytes; i++)
+	{
+		u8 byte = reader->data[reader->pos++];
+		reader->hash = (reader->hash ^ byte) * SAVE_FNV_PRIME;
+		value |= (u64)byte << (8 * i);
+	}
+	return value;
+}
+
+bool saveWrite(const char *path, Board *board, const SaveGame *save)
+{
+	char tempPath[256];
+	snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+	// on the stack, saving allocates nothing of its own
+	SaveWriter writer = {
+		.file = fopen(tempPath, "wb"),
+		.hash = SAVE_FNV_BASIS
+	};
+	if (!writer.file)
+	{
+		fprintf(stderr, "Failed to open %s for writing\n", tempPath);
+		return false;
+	}
+
+	for (i32 i = 0; i < 4; i++)
+		savePut(&writer, SAVE_MAGIC[i], 1);
+	savePut(&writer, SAVE_VERSION, 2);
+	savePut(&writer, board->width, 2);
+	savePut(&writer, board->height, 2);
+	savePut(&writer, board->numColors, 2);
+	savePut(&writer, board->seed, 8);
+	savePut(&writer, save->gameTimer, 8);
+	savePut(&writer, (save->timerStarted ? SAVE_FLAG_TIMER_STARTED : 0)
+	                 | (save->piping ? SAVE_FLAG_PIPING : 0), 1);
+	savePut(&writer, save->endPoint, 1);
+	savePut(&writer, save->selectedColor, 2);
+	savePut(&writer, save->pipeSeqSize, 4);
+
+	for (i32 r = 0; r < board->height; r++)
+	{
+		const Cell *cell = boardGet(board, r, 0);
+		for (i32 c = 0; c < board->width; c++, cell++)
+		{
+			savePut(&writer, cell->state | cell->connection << 4, 1);
+			savePut(&writer, cell->color, 2);
+		}
+	}
+	for (i32 i = 0; i < save->pipeSeqSize; i++)
+	{
+		savePut(&writer, save->pipeSeq[i].x, 2);
+		savePut(&writer, save->pipeSeq[i].y, 2);
+	}
+	savePut(&writer, writer.hash, SAVE_CHECK_SIZE);
+	saveFlush(&writer);
+
+	// Not synced to disk: that would cost milliseconds on every completed
+	// flow. The rename still never leaves a half written save behind when
+	// the game itself stops midway.
+	if (fclose(writer.file) != 0 || writer.failed)
+	{
+		fprintf(stderr, "Failed to write %s\n", tempPath);
+		remove(tempPath);
+		return false;
+	}
+	if (rename(tempPath, path) != 0)
+	{
+		fprintf(stderr, "Failed to rename %s to %s\n", tempPath, path);
+		remove(tempPath);
+		return false;
+	}
+	return true;
+}
+
+// the board part of a save, checking every value before it is used
+static Board* saveReadBoard(SaveReader *reader, SaveGame *save)
+{
+	char magic[4];
+	for (i32 i = 0; i < 4; i++)
+		magic[i] = (char)saveGet(reader, 1);
+	if (memcmp(magic, SAVE_MAGIC, 4) != 0)
+		return NULL;
+
+	u64 version = saveGet(reader, 2);
+	if (version != SAVE_VERSION)
+	{
+		fprintf(stderr, "Save version %llu, this build reads %i\n",
+		        (unsigned long long)version, SAVE_VERSION);
+		return NULL;
+	}
+
+	i32 width = saveGet(reader, 2);
+	i32 height = saveGet(reader, 2);
+	i32 numColors = saveGet(reader, 2);
+	u64 seed = saveGet(reader, 8);
+	save->gameTimer = saveGet(reader, 8);
+	u8 flags = saveGet(reader, 1);
+	save->endPoint = saveGet(reader, 1);
+	save->selectedColor = saveGet(reader, 2);
+	save->pipeSeqSize = saveGet(reader, 4);
+	save->timerStarted = flags & SAVE_FLAG_TIMER_STARTED;
+	save->piping = flags & SAVE_FLAG_PIPING;
+
+	// sizes are checked against the file before anything is allocated
+	size_t cells = (size_t)width * height;
+	size_t expected = SAVE_HEADER_SIZE + cells * SAVE_CELL_SIZE
+	                  + (size_t)save->pipeSeqSize * SAVE_SEQ_SIZE
+	                  + SAVE_CHECK_SIZE;
+	if (   reader->failed
+	    || width == 0 || height == 0
+	    // the most pipes a board can hold, the palette is sized for it
+	    || (size_t)numColors > cells / 3
+	    || (size_t)save->pipeSeqSize > cells
+	    || expected != reader->size
+	    || (   save->endPoint != CELLSTATE_PIPE_START
+	        && save->endPoint != CELLSTATE_PIPE_END)
+	    || (save->piping && save->selectedColor >= numColors))
+	{
+		return NULL;
+	}
+
+	Board *board = boardCreate(width, height);
+	board->numColors = numColors;
+	board->seed = seed;
+	save->pipeSeq = memAlloc(sizeof(SDL_Point) * cells);
+
+	bool valid = true;
+	for (i32 r = 0; r < height; r++)
+	{
+		Cell *cell = boardGet(board, r, 0);
+		for (i32 c = 0; c < width; c++, cell++)
+		{
+			u8 packed = saveGet(reader, 1);
+			cell->state = packed & 0xf;
+			cell->connection = packed >> 4;
+			cell->color = saveGet(reader, 2);
+			if (   cell->state >= CELLSTATE_COUNT
+			    || cell->connection >= CELLCONNECTION_COUNT
+			    || (boardIsPipe(cell) && cell->color >= numColors))
+			{
+				valid = false;
+			}
+		}
+	}
+	for (i32 i = 0; i < save->pipeSeqSize; i++)
+	{
+		save->pipeSeq[i].x = saveGet(reader, 2);
+		save->pipeSeq[i].y = saveGet(reader, 2);
+		if (!boardBoundsCheck(board, save->pipeSeq[i].y, save->pipeSeq[i].x))
+			valid = false;
+	}
+
+	u32 hash = reader->hash;
+	if (!valid || saveGet(reader, SAVE_CHECK_SIZE) != hash || reader->failed)
+	{
+		saveFree(save);
+		boardFree(board);
+		return NULL;
+	}
+	return board;
+}
+
+Board* saveRead(const char *path, SaveGame *save)
+{
+	*save = (SaveGame){0};
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	u8 *data = size > 0 ? memAlloc(size) : NULL;
+	bool read = data && fread(data, 1, size, file) == (size_t)size;
+	fclose(file);
+
+	Board *board = NULL;
+	if (read)
+	{
+		SaveReader reader = {
+			.data = data,
+			.size = size,
+			.hash = SAVE_FNV_BASIS
+		};
+		board = saveReadBoard(&reader, save);
+	}
+	memFree(data);
+
+	if (!board)
+		fprintf(stderr, "%s is not a save this build can resume\n", path);
+	return board;
+}
+
+void saveFree(SaveGame *save)
+{
+	memFree(save->pipeSeq);
+	save->pipeSeq = NULL;
+	save->pipeSeqSize = 0;
+}
+
+bool saveExists(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+bool saveRemove(const char *path)
+{
+	return remove(path) == 0;
+}
@@ -0,0 +1,43 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+
+#define SAVE_PATH "flow.sav"
+
+// bumped whenever the layout changes, older saves are refused
+#define SAVE_VERSION 1
+
+// The play state a saved game holds besides its board. pipeSeq is the pipe
+// being drawn, pipeSeqSize cells of it, in board columns (x) and rows (y).
+typedef struct
+{
+	u64 gameTimer;
+	bool timerStarted;
+	bool piping;
+	CellColor selectedColor;
+	CellState endPoint;
+	SDL_Point *pipeSeq;
+	i32 pipeSeqSize;
+} SaveGame;
+
+// Writes the board, its seed and save to a temporary file next to path,
+// then renames it over path, so path always holds a whole save.
+bool saveWrite(const char *path, Board *board, const SaveGame *save);
+
+// The board of the save at path, with save filled in and save->pipeSeq
+// allocated for every cell of it; NULL when there is none or it does not
+// check out. saveFree releases pipeSeq.
+Board* saveRead(const char *path, SaveGame *save);
+
+void saveFree(SaveGame *save);
+
+bool saveExists(const char *path);
+
+// false when there was none
+bool saveRemove(const char *path);
+
+#endif
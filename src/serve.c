@@ -0,0 +1,593 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <SDL2/SDL.h>
+
+#include "serve.h"
+#include "mem.h"
+
+static void servePut16(u8 *p, u16 v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void servePut32(u8 *p, u32 v)
+{
+	servePut16(p, v);
+	servePut16(p + 2, v >> 16);
+}
+
+static void servePut64(u8 *p, u64 v)
+{
+	servePut32(p, v);
+	servePut32(p + 4, v >> 32);
+}
+
+static u16 serveGet16(const u8 *p)
+{
+	return p[0] | (u16)p[1] << 8;
+}
+
+static u32 serveGet32(const u8 *p)
+{
+	return serveGet16(p) | (u32)serveGet16(p + 2) << 16;
+}
+
+static u64 serveGet64(const u8 *p)
+{
+	return serveGet32(p) | (u64)serveGet32(p + 4) << 32;
+}
+
+void serveEncodeRequest(u8 *buffer, const ServeRequest *request)
+{
+	memset(buffer, 0, SERVE_REQUEST_SIZE);
+	servePut16(buffer, request->width);
+	servePut16(buffer + 2, request->height);
+	servePut64(buffer + 8, request->seed);
+}
+
+void serveDecodeRequest(const u8 *buffer, ServeRequest *request)
+{
+	request->width = serveGet16(buffer);
+	request->height = serveGet16(buffer + 2);
+	request->seed = serveGet64(buffer + 8);
+}
+
+void serveEncodeHeader(u8 *buffer, const ServeHeader *header)
+{
+	memset(buffer, 0, SERVE_HEADER_SIZE);
+	buffer[0] = header->status;
+	servePut16(buffer + 4, header->width);
+	servePut16(buffer + 6, header->height);
+	servePut32(buffer + 8, header->numColors);
+	servePut64(buffer + 12, header->seed);
+}
+
+void serveDecodeHeader(const u8 *buffer, ServeHeader *header)
+{
+	header->status = buffer[0];
+	header->width = serveGet16(buffer + 4);
+	header->height = serveGet16(buffer + 6);
+	header->numColors = serveGet32(buffer + 8);
+	header->seed = serveGet64(buffer + 12);
+}
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "board.h"
+#include "genpool.h"
+
+#define SERVE_MAX_EVENTS 64
+
+// every slot holds a job, running or done, unless submitting it failed
+typedef struct
+{
+	i32 size;
+	GenJob *jobs[SERVE_POOL_DEPTH];
+} ServePool;
+
+typedef enum
+{
+	SERVECLIENT_READING,
+	SERVECLIENT_WAITING,
+	SERVECLIENT_WRITING
+} ServeClientState;
+
+typedef struct ServeClient
+{
+	i32 fd;
+	ServeClientState state;
+	u8 request[SERVE_REQUEST_SIZE];
+	i32 requestLength;
+
+	// while waiting: the warm pool the board comes from, or the job
+	// generating it when the request cannot come from a pool
+	ServePool *pool;
+	GenJob *job;
+
+	u8 *response;
+	i32 responseLength;
+	i32 responseSent;
+	i32 responseCapacity;
+
+	struct ServeClient *next;
+} ServeClient;
+
+typedef struct
+{
+	i32 listenFd;
+	i32 epollFd;
+	// written by the workers whenever a job is done, so the loop only
+	// wakes up when there may be a board for a waiting client
+	i32 doneFd;
+	GenPool genPool;
+	ServePool *pools;
+	i32 numPools;
+	ServeClient *clients;
+	u64 served;
+} Server;
+
+static volatile sig_atomic_t serveQuit = 0;
+
+static void serveOnSignal(i32 signal)
+{
+	(void)signal;
+	serveQuit = 1;
+}
+
+// seeds are drawn here, on the loop thread, rather than by boardGenerate
+// on the workers
+static Board* serveNewBoard(i32 width, i32 height, u64 seed)
+{
+	Board *board = boardCreate(width, height);
+	board->seed = seed ? seed : ((u64)rand() << 32) ^ (u64)rand() ^ 1;
+	board->quiet = true;
+	return board;
+}
+
+static void serveOnDone(void *data)
+{
+	Server *server = data;
+	u64 one = 1;
+	ssize_t written = write(server->doneFd, &one, sizeof(one));
+	(void)written;
+}
+
+// a board of size queued on the workers, NULL if it could not be
+static GenJob* serveSubmit(Server *server, i32 size)
+{
+	Board *board = serveNewBoard(size, size, 0);
+	GenJob *job = genPoolSubmit(&server->genPool, board);
+	if (!job)
+		boardFree(board);
+	return job;
+}
+
+// A finished board out of the pool with a new one queued in its place,
+// NULL if none is ready yet. Slots whose job could not be queued are
+// tried again; failed says when no slot has one, so no board is coming.
+static Board* serveTake(Server *server, ServePool *pool, bool *failed)
+{
+	for (i32 i = 0; i < SERVE_POOL_DEPTH; i++)
+	{
+		GenJob *job = pool->jobs[i];
+		if (!job)
+		{
+			pool->jobs[i] = serveSubmit(server, pool->size);
+			continue;
+		}
+		if (!genJobDone(job))
+			continue;
+
+		Board *board = job->result ? job->board : NULL;
+		if (!board)
+			boardFree(job->board);
+		genJobFree(job);
+		pool->jobs[i] = serveSubmit(server, pool->size);
+		if (board)
+			return board;
+	}
+
+	*failed = true;
+	for (i32 i = 0; i < SERVE_POOL_DEPTH; i++)
+	{
+		if (pool->jobs[i])
+			*failed = false;
+	}
+	return NULL;
+}
+
+static bool serveWatch(Server *server, ServeClient *client, u32 events)
+{
+	struct epoll_event event = {.events = events, .data.ptr = client};
+	return epoll_ctl(server->epollFd, EPOLL_CTL_MOD, client->fd, &event) == 0;
+}
+
+static void serveReserve(ServeClient *client, i32 length)
+{
+	if (length > client->responseCapacity)
+	{
+		client->response = memRealloc(client->response, length);
+		client->responseCapacity = length;
+	}
+	client->responseLength = length;
+	client->responseSent = 0;
+}
+
+// Queues the response for a request, board NULL for a failed one. Takes
+// the board.
+static void serveRespond(Server *server, ServeClient *client, Board *board,
+                         ServeStatus status)
+{
+	ServeHeader header = {.status = status};
+	if (board)
+	{
+		header.width = board->width;
+		header.height = board->height;
+		header.numColors = board->numColors;
+		header.seed = board->seed;
+	}
+
+	serveReserve(client, SERVE_HEADER_SIZE + header.numColors * 8);
+	serveEncodeHeader(client->response, &header);
+
+	if (board)
+	{
+		u8 *pairs = client->response + SERVE_HEADER_SIZE;
+		for (i32 r = 0; r < board->height; r++)
+		{
+			for (i32 c = 0; c < board->width; c++)
+			{
+				Cell *cell = boardGet(board, r, c);
+				if (cell->color >= header.numColors)
+					continue;
+				if (cell->state == CELLSTATE_PIPE_START)
+					servePut32(pairs + cell->color * 8, r * board->width + c);
+				else if (cell->state == CELLSTATE_PIPE_END)
+					servePut32(pairs + cell->color * 8 + 4, r * board->width + c);
+			}
+		}
+		boardFree(board);
+		server->served += 1;
+	}
+
+	client->pool = NULL;
+	client->job = NULL;
+	client->state = SERVECLIENT_WRITING;
+	serveWatch(server, client, EPOLLOUT);
+}
+
+// answers the client from its pool once a board is ready there
+static void serveFromPool(Server *server, ServeClient *client)
+{
+	bool failed = false;
+	Board *board = serveTake(server, client->pool, &failed);
+	if (board)
+		serveRespond(server, client, board, SERVE_OK);
+	else if (failed)
+		serveRespond(server, client, NULL, SERVE_FAILED);
+}
+
+static void serveRequest(Server *server, ServeClient *client)
+{
+	ServeRequest request;
+	serveDecodeRequest(client->request, &request);
+	client->requestLength = 0;
+
+	if (   request.width < 3 || request.width > SERVE_MAX_SIZE
+	    || request.height < 3 || request.height > SERVE_MAX_SIZE)
+	{
+		serveRespond(server, client, NULL, SERVE_BAD_REQUEST);
+		return;
+	}
+
+	// no events while the board is made, anything the client sends in
+	// the meantime waits in the socket
+	client->state = SERVECLIENT_WAITING;
+	serveWatch(server, client, 0);
+
+	if (request.seed == 0 && request.width == request.height)
+	{
+		for (i32 i = 0; i < server->numPools; i++)
+		{
+			if (server->pools[i].size == request.width)
+				client->pool = &server->pools[i];
+		}
+	}
+
+	if (client->pool)
+	{
+		serveFromPool(server, client);
+		return;
+	}
+
+	Board *board = serveNewBoard(request.width, request.height, request.seed);
+	client->job = genPoolSubmit(&server->genPool, board);
+	if (!client->job)
+	{
+		boardFree(board);
+		serveRespond(server, client, NULL, SERVE_FAILED);
+	}
+}
+
+// answers every client whose board has turned up
+static void serveCheckWaiting(Server *server)
+{
+	for (ServeClient *client = server->clients; client; client = client->next)
+	{
+		if (client->state != SERVECLIENT_WAITING)
+			continue;
+
+		if (client->pool)
+		{
+			serveFromPool(server, client);
+		}
+		else if (client->job && genJobDone(client->job))
+		{
+			GenJob *job = client->job;
+			Board *board = job->board;
+			bool placed = job->result;
+			genJobFree(job);
+			if (placed)
+			{
+				serveRespond(server, client, board, SERVE_OK);
+			}
+			else
+			{
+				boardFree(board);
+				serveRespond(server, client, NULL, SERVE_FAILED);
+			}
+		}
+	}
+}
+
+static void serveClose(Server *server, ServeClient *client)
+{
+	ServeClient **link = &server->clients;
+	while (*link != client)
+		link = &(*link)->next;
+	*link = client->next;
+
+	// the board may only go once no worker can touch it any more
+	if (client->job)
+	{
+		genJobCancel(&server->genPool, client->job);
+		boardFree(client->job->board);
+		genJobFree(client->job);
+	}
+	epoll_ctl(server->epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	memFree(client->response);
+	memFree(client);
+}
+
+static void serveAccept(Server *server)
+{
+	for (;;)
+	{
+		i32 fd = accept(server->listenFd, NULL, NULL);
+		if (fd < 0)
+			return;
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+		ServeClient *client = memCalloc(1, sizeof(ServeClient));
+		client->fd = fd;
+		client->state = SERVECLIENT_READING;
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = client};
+		if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close(fd);
+			memFree(client);
+			continue;
+		}
+		client->next = server->clients;
+		server->clients = client;
+	}
+}
+
+// false once the client is gone
+static bool serveRead(Server *server, ServeClient *client)
+{
+	while (client->state == SERVECLIENT_READING)
+	{
+		ssize_t n = read(client->fd, client->request + client->requestLength,
+		                 SERVE_REQUEST_SIZE - client->requestLength);
+		if (n == 0)
+			return false;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+		client->requestLength += n;
+		if (client->requestLength == SERVE_REQUEST_SIZE)
+			serveRequest(server, client);
+	}
+	return true;
+}
+
+static bool serveWrite(Server *server, ServeClient *client)
+{
+	while (client->responseSent < client->responseLength)
+	{
+		ssize_t n = write(client->fd, client->response + client->responseSent,
+		                  client->responseLength - client->responseSent);
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		client->responseSent += n;
+	}
+
+	client->state = SERVECLIENT_READING;
+	serveWatch(server, client, EPOLLIN);
+	return true;
+}
+
+static bool serveListen(Server *server, const char *path)
+{
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+
+	// a socket left behind by a daemon that did not exit cleanly
+	unlink(path);
+
+	server->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (   server->listenFd < 0
+	    || bind(server->listenFd, (struct sockaddr*)&address,
+	            sizeof(address)) != 0
+	    || listen(server->listenFd, SOMAXCONN) != 0)
+	{
+		fprintf(stderr, "Failed to listen on %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	fcntl(server->listenFd, F_SETFL,
+	      fcntl(server->listenFd, F_GETFL) | O_NONBLOCK);
+
+	// the listening socket is told apart by its NULL, the done eventfd
+	// by the server
+	server->epollFd = epoll_create1(0);
+	server->doneFd = eventfd(0, EFD_NONBLOCK);
+	struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+	struct epoll_event done = {.events = EPOLLIN, .data.ptr = server};
+	if (   server->epollFd < 0
+	    || server->doneFd < 0
+	    || epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd,
+	                 &event) != 0
+	    || epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->doneFd,
+	                 &done) != 0)
+	{
+		fprintf(stderr, "Failed to set up epoll: %s\n", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+i32 serveMain(i32 argc, char *argv[])
+{
+	const char *path = argc > 0 ? argv[0] : SERVE_DEFAULT_PATH;
+	i32 minSize      = argc > 1 ? atoi(argv[1]) : 5;
+	i32 maxSize      = argc > 2 ? atoi(argv[2]) : 14;
+	if (minSize < 3)
+		minSize = 3;
+	if (maxSize < minSize)
+		maxSize = minSize - 1;
+
+	Server server = {.listenFd = -1, .epollFd = -1, .doneFd = -1};
+	srand(time(NULL));
+
+	struct sigaction action = {.sa_handler = serveOnSignal};
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (!genPoolInit(&server.genPool, 0))
+		return 1;
+
+	bool ok = serveListen(&server, path);
+	if (ok)
+	{
+		server.genPool.onDone = serveOnDone;
+		server.genPool.onDoneData = &server;
+		server.numPools = maxSize - minSize + 1;
+		server.pools = memAlloc(sizeof(ServePool) * (server.numPools + 1));
+		for (i32 i = 0; i < server.numPools; i++)
+		{
+			server.pools[i].size = minSize + i;
+			for (i32 j = 0; j < SERVE_POOL_DEPTH; j++)
+				server.pools[i].jobs[j] = serveSubmit(&server, minSize + i);
+		}
+		fprintf(stderr, "Serving %ix%i to %ix%i boards on %s\n",
+		        minSize, minSize, maxSize, maxSize, path);
+	}
+
+	struct epoll_event events[SERVE_MAX_EVENTS];
+	while (ok && !serveQuit)
+	{
+		i32 count = epoll_wait(server.epollFd, events, SERVE_MAX_EVENTS, -1);
+		for (i32 i = 0; i < count; i++)
+		{
+			ServeClient *client = events[i].data.ptr;
+			if (!client)
+			{
+				serveAccept(&server);
+				continue;
+			}
+			if (events[i].data.ptr == &server)
+			{
+				// every job done since, serveCheckWaiting looks at them all
+				u64 done;
+				ssize_t n = read(server.doneFd, &done, sizeof(done));
+				(void)n;
+				continue;
+			}
+
+			bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP))
+			             || (events[i].events & EPOLLIN);
+			if (alive && (events[i].events & EPOLLIN))
+				alive = serveRead(&server, client);
+			if (alive && (events[i].events & EPOLLOUT))
+				alive = serveWrite(&server, client);
+			if (!alive)
+				serveClose(&server, client);
+		}
+		serveCheckWaiting(&server);
+	}
+
+	fprintf(stderr, "Served %llu boards\n", (unsigned long long)server.served);
+
+	while (server.clients)
+		serveClose(&server, server.clients);
+
+	// the pool cancels and joins everything, after that the boards are ours
+	genPoolQuit(&server.genPool);
+	for (i32 i = 0; i < server.numPools; i++)
+	{
+		for (i32 j = 0; j < SERVE_POOL_DEPTH; j++)
+		{
+			GenJob *job = server.pools[i].jobs[j];
+			if (!job)
+				continue;
+			boardFree(job->board);
+			genJobFree(job);
+		}
+	}
+	memFree(server.pools);
+
+	if (server.epollFd >= 0)
+		close(server.epollFd);
+	if (server.doneFd >= 0)
+		close(server.doneFd);
+	if (server.listenFd >= 0)
+	{
+		close(server.listenFd);
+		unlink(path);
+	}
+	return ok ? 0 : 1;
+}
+
+#else
+
+i32 serveMain(i32 argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "The puzzle daemon needs Linux\n");
+	return 1;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdbool.h>
+#include "common.h"
+
+#define SERVE_DEFAULT_PATH "flow.sock"
+
+// boards generated ahead of time for every size the daemon keeps warm
+#define SERVE_POOL_DEPTH 16
+
+// biggest board a request may ask for, on either side
+#define SERVE_MAX_SIZE 1024
+
+// Wire format, every field little-endian.
+//
+// request, SERVE_REQUEST_SIZE bytes:
+//   u16 width, u16 height, u32 reserved (0), u64 seed (0 for any board)
+//
+// response, SERVE_HEADER_SIZE bytes followed by numColors endpoint pairs:
+//   u8 status (ServeStatus), u8[3] reserved, u16 width, u16 height,
+//   u32 numColors, u64 seed, then per color u32 start and u32 end, each a
+//   cell index row * width + col
+#define SERVE_REQUEST_SIZE 16
+#define SERVE_HEADER_SIZE 20
+
+typedef enum
+{
+	SERVE_OK,
+	SERVE_BAD_REQUEST,
+	SERVE_FAILED
+} ServeStatus;
+
+typedef struct
+{
+	u16 width;
+	u16 height;
+	u64 seed;
+} ServeRequest;
+
+typedef struct
+{
+	u8 status;
+	u16 width;
+	u16 height;
+	u32 numColors;
+	u64 seed;
+} ServeHeader;
+
+void serveEncodeRequest(u8 *buffer, const ServeRequest *request);
+
+void serveDecodeRequest(const u8 *buffer, ServeRequest *request);
+
+void serveEncodeHeader(u8 *buffer, const ServeHeader *header);
+
+void serveDecodeHeader(const u8 *buffer, ServeHeader *header);
+
+// Puzzle daemon, run as: flow --serve [path] [min size] [max size]
+// Keeps SERVE_POOL_DEPTH boards of every square size from min to max
+// (5 to 14 by default) generated on the worker pool and answers requests
+// on the Unix socket at path from a single epoll loop. Seeded requests
+// and other sizes are generated when they come in. Linux only.
+i32 serveMain(i32 argc, char *argv[]);
+
+// Load generator for the daemon, run as:
+//   flow --load [path] [connections] [requests] [size]
+// Keeps every connection busy with one request at a time and reports
+// requests per second and latency percentiles on stdout.
+i32 serveLoadMain(i32 argc, char *argv[]);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "snapshot.h"
+#include "mem.h"
+
+Snapshots* snapshotsCreate(const Cell *cells, i32 numCells)
+{
+	Snapshots *snapshots = memAlloc(sizeof(Snapshots));
+	if (!snapshots)
+		return NULL;
+
+	// one block for all three slots
+	Cell *block = memAlloc(sizeof(Cell) * numCells * 3);
+	if (!block)
+	{
+		fprintf(stderr, "Failed to allocate board snapshots\n");
+		memFree(snapshots);
+		return NULL;
+	}
+
+	for (i32 i = 0; i < 3; i++)
+	{
+		snapshots->slots[i] = block + numCells * i;
+		memcpy(snapshots->slots[i], cells, sizeof(Cell) * numCells);
+	}
+	snapshots->numCells = numCells;
+	snapshots->front = 0;
+	SDL_AtomicSet(&snapshots->shared, 1);
+	snapshots->back = 2;
+	snapshots->lastPublish = 0;
+	return snapshots;
+}
+
+void snapshotsFree(Snapshots *snapshots)
+{
+	if (!snapshots)
+		return;
+	memFree(snapshots->slots[0]);
+	memFree(snapshots);
+}
+
+void snapshotsPublish(Snapshots *snapshots, const Cell *cells, bool force)
+{
+	u64 now = SDL_GetTicks64();
+	if (!force && now - snapshots->lastPublish < SNAPSHOT_INTERVAL_MS)
+		return;
+
+	memcpy(snapshots->slots[snapshots->back], cells,
+	       sizeof(Cell) * snapshots->numCells);
+	i32 old = SDL_AtomicSet(&snapshots->shared,
+	                        snapshots->back | SNAPSHOT_FRESH);
+	snapshots->back = old & SNAPSHOT_SLOT_MASK;
+	snapshots->lastPublish = now;
+}
+
+const Cell* snapshotsLatest(Snapshots *snapshots)
+{
+	// if the writer publishes again in between, the exchange hands over
+	// that newer slot instead, which is just as good
+	if (SDL_AtomicGet(&snapshots->shared) & SNAPSHOT_FRESH)
+	{
+		i32 old = SDL_AtomicSet(&snapshots->shared, snapshots->front);
+		snapshots->front = old & SNAPSHOT_SLOT_MASK;
+	}
+	return snapshots->slots[snapshots->front];
+}
@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "board.h"
+
+// the generator publishes at most this often, however fast it runs
+#define SNAPSHOT_INTERVAL_MS 16
+
+// set on the shared slot index while the reader has not taken it yet
+#define SNAPSHOT_FRESH 4
+#define SNAPSHOT_SLOT_MASK 3
+
+// Triple buffer of board cells from one writer to one reader. Each side
+// owns a slot of its own and trades it for the shared one with a single
+// atomic exchange, so neither ever waits for the other and the reader
+// always sees a complete copy.
+struct Snapshots
+{
+	Cell *slots[3];
+	i32 numCells;
+	SDL_atomic_t shared;
+
+	// writer side
+	i32 back;
+	u64 lastPublish;
+
+	// reader side
+	i32 front;
+};
+
+// every slot starts out as a copy of cells
+Snapshots* snapshotsCreate(const Cell *cells, i32 numCells);
+
+void snapshotsFree(Snapshots *snapshots);
+
+// publishes a copy of cells, unless force is false and the last one went
+// out less than SNAPSHOT_INTERVAL_MS ago
+void snapshotsPublish(Snapshots *snapshots, const Cell *cells, bool force);
+
+// the newest published cells, valid until the next call
+const Cell* snapshotsLatest(Snapshots *snapshots);
+
+#endif
@@ -0,0 +1,479 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "solver.h"
+
+bool solverInit(Solver *solver, Board *board)
+{
+	*solver = (Solver){
+		.width = board->width,
+		.height = board->height,
+		.stride = board->stride,
+		.numCells = board->numCells
+	};
+	memcpy(solver->delta, board->delta, sizeof(solver->delta));
+
+	// pipes are numbered by their color
+	i32 numPipes = 0;
+	for (i32 i = 0; i < board->numCells; i++)
+	{
+		Cell *cell = &board->cells[i];
+		bool endpoint = cell->state == CELLSTATE_PIPE_START
+		                || cell->state == CELLSTATE_PIPE_END;
+		if (endpoint && cell->color >= numPipes)
+			numPipes = cell->color + 1;
+	}
+	if (numPipes == 0)
+		return false;
+	solver->numPipes = numPipes;
+
+	// every move takes an empty cell or finishes a pipe
+	i32 size = board->width * board->height;
+	i32 padded = board->numCells;
+	size_t arenaSize = sizeof(i32) * padded
+	                   + sizeof(i32) * numPipes * 3
+	                   + sizeof(SolverMove) * (size + numPipes)
+	                   + (sizeof(u32) * 2 + sizeof(i32) * 2) * padded
+	                   + 16 * 8;
+	if (!arenaInit(&solver->arena, arenaSize))
+		return false;
+
+	solver->owner = arenaAlloc(&solver->arena, sizeof(i32) * padded);
+	solver->head = arenaAlloc(&solver->arena, sizeof(i32) * numPipes);
+	solver->target = arenaAlloc(&solver->arena, sizeof(i32) * numPipes);
+	solver->start = arenaAlloc(&solver->arena, sizeof(i32) * numPipes);
+	solver->moves = arenaAlloc(&solver->arena,
+	                           sizeof(SolverMove) * (size + numPipes));
+	solver->visited = arenaAlloc(&solver->arena, sizeof(u32) * padded);
+	solver->served = arenaAlloc(&solver->arena, sizeof(u32) * padded);
+	solver->component = arenaAlloc(&solver->arena, sizeof(i32) * padded);
+	solver->stack = arenaAlloc(&solver->arena, sizeof(i32) * padded);
+	memset(solver->visited, 0, sizeof(u32) * padded);
+	memset(solver->served, 0, sizeof(u32) * padded);
+
+	for (i32 p = 0; p < numPipes; p++)
+	{
+		solver->head[p] = -1;
+		solver->target[p] = -1;
+	}
+
+	bool valid = true;
+	for (i32 i = 0; i < padded; i++)
+	{
+		Cell *cell = &board->cells[i];
+		switch (cell->state)
+		{
+			case CELLSTATE_WALL:
+				solver->owner[i] = SOLVER_WALL;
+				break;
+			case CELLSTATE_PIPE_START:
+				valid = valid && solver->head[cell->color] < 0;
+				solver->head[cell->color] = i;
+				solver->start[cell->color] = i;
+				solver->owner[i] = cell->color;
+				break;
+			case CELLSTATE_PIPE_END:
+				valid = valid && solver->target[cell->color] < 0;
+				solver->target[cell->color] = i;
+				solver->owner[i] = cell->color;
+				break;
+			default:
+				solver->owner[i] = SOLVER_EMPTY;
+				solver->numEmpty += 1;
+				break;
+		}
+	}
+
+	for (i32 p = 0; p < numPipes; p++)
+	{
+		if (solver->head[p] < 0 || solver->target[p] < 0)
+			valid = false;
+	}
+	if (!valid)
+	{
+		solverFree(solver);
+		return false;
+	}
+
+	solver->numUnfinished = numPipes;
+	return true;
+}
+
+void solverFree(Solver *solver)
+{
+	arenaFree(&solver->arena);
+}
+
+static bool solverAdjacent(Solver *solver, i32 a, i32 b)
+{
+	for (i32 d = 0; d < 4; d++)
+	{
+		if (a + solver->delta[d] == b)
+			return true;
+	}
+	return false;
+}
+
+// the cells the head of pipe may move onto next, returns how many
+static i32 solverMoves(Solver *solver, i32 pipe, i32 *moves)
+{
+	i32 head = solver->head[pipe];
+	i32 target = solver->target[pipe];
+
+	// a head next to its end has to take it, going anywhere else would
+	// leave the end touching the pipe twice
+	if (solverAdjacent(solver, head, target))
+	{
+		moves[0] = target;
+		return 1;
+	}
+
+	i32 count = 0;
+	for (i32 d = 0; d < 4; d++)
+	{
+		i32 q = head + solver->delta[d];
+		if (solver->owner[q] != SOLVER_EMPTY)
+			continue;
+
+		bool touches = false;
+		for (i32 e = 0; e < 4; e++)
+		{
+			i32 r = q + solver->delta[e];
+			if (r != head && r != target && solver->owner[r] == pipe)
+				touches = true;
+		}
+		if (!touches)
+			moves[count++] = q;
+	}
+	return count;
+}
+
+static void solverMove(Solver *solver, i32 pipe, i32 cell)
+{
+	solver->moves[solver->numMoves++] = (SolverMove){
+		.cell = cell,
+		.pipe = pipe,
+		.previousHead = solver->head[pipe]
+	};
+	solver->head[pipe] = cell;
+
+	if (cell == solver->target[pipe])
+	{
+		solver->numUnfinished -= 1;
+	}
+	else
+	{
+		solver->owner[cell] = pipe;
+		solver->numEmpty -= 1;
+	}
+}
+
+// takes back every move after the first mark ones
+static void solverUndo(Solver *solver, i32 mark)
+{
+	while (solver->numMoves > mark)
+	{
+		SolverMove *move = &solver->moves[--solver->numMoves];
+		if (move->cell == solver->target[move->pipe])
+		{
+			solver->numUnfinished += 1;
+		}
+		else
+		{
+			solver->owner[move->cell] = SOLVER_EMPTY;
+			solver->numEmpty += 1;
+		}
+		solver->head[move->pipe] = move->previousHead;
+	}
+}
+
+bool solverFixPath(Solver *solver, i32 pipe, const i32 *cells, i32 count)
+{
+	i32 mark = solver->numMoves;
+	bool reversed = cells[0] == solver->target[pipe];
+	if (!reversed && cells[0] != solver->head[pipe])
+		return false;
+
+	if (reversed)
+	{
+		solver->target[pipe] = solver->head[pipe];
+		solver->head[pipe] = cells[0];
+	}
+
+	for (i32 i = 1; i < count; i++)
+	{
+		i32 cell = cells[i];
+		bool open = solver->owner[cell] == SOLVER_EMPTY
+		            || (cell == solver->target[pipe] && i == count - 1);
+		if (!open || !solverAdjacent(solver, solver->head[pipe], cell))
+		{
+			solverUndo(solver, mark);
+			if (reversed)
+			{
+				solver->head[pipe] = solver->target[pipe];
+				solver->target[pipe] = cells[0];
+			}
+			return false;
+		}
+		solverMove(solver, pipe, cell);
+	}
+	return true;
+}
+
+void solverReset(Solver *solver)
+{
+	solverUndo(solver, 0);
+	for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+	{
+		if (solver->head[pipe] != solver->start[pipe])
+		{
+			solver->target[pipe] = solver->head[pipe];
+			solver->head[pipe] = solver->start[pipe];
+		}
+	}
+}
+
+static u32 solverNextEpoch(Solver *solver)
+{
+	solver->epoch += 1;
+	if (solver->epoch == 0)
+	{
+		memset(solver->visited, 0, sizeof(u32) * solver->numCells);
+		memset(solver->served, 0, sizeof(u32) * solver->numCells);
+		solver->epoch = 1;
+	}
+	return solver->epoch;
+}
+
+// the head or the end of a pipe that is still open, something an empty
+// neighbour can connect to
+static bool solverIsOpenEnd(Solver *solver, i32 cell)
+{
+	i32 pipe = solver->owner[cell];
+	if (pipe < 0 || solver->head[pipe] == solver->target[pipe])
+		return false;
+	return cell == solver->head[pipe] || cell == solver->target[pipe];
+}
+
+// Cheap proofs that the position has no solution:
+// - an empty cell needs two neighbours a pipe can come in and go out by,
+// - every open pipe needs an empty region touching both its ends,
+// - and every empty region needs such a pipe to reach it, or nothing will
+//   ever fill it.
+static bool solverPrune(Solver *solver)
+{
+	const i32 *owner = solver->owner;
+	u32 *visited = solver->visited;
+	i32 *component = solver->component;
+	i32 *stack = solver->stack;
+	u32 epoch = solverNextEpoch(solver);
+	i32 numComponents = 0;
+
+	for (i32 row = 0; row < solver->height; row++)
+	{
+		i32 p = (row + 1) * solver->stride + 1;
+		for (i32 col = 0; col < solver->width; col++, p++)
+		{
+			if (owner[p] != SOLVER_EMPTY)
+				continue;
+
+			i32 open = 0;
+			for (i32 d = 0; d < 4; d++)
+			{
+				i32 q = p + solver->delta[d];
+				if (owner[q] == SOLVER_EMPTY || solverIsOpenEnd(solver, q))
+					open += 1;
+			}
+			if (open < 2)
+				return false;
+
+			if (visited[p] == epoch)
+				continue;
+
+			visited[p] = epoch;
+			component[p] = numComponents;
+			stack[0] = p;
+			i32 top = 1;
+			while (top > 0)
+			{
+				i32 i = stack[--top];
+				for (i32 d = 0; d < 4; d++)
+				{
+					i32 q = i + solver->delta[d];
+					if (owner[q] == SOLVER_EMPTY && visited[q] != epoch)
+					{
+						visited[q] = epoch;
+						component[q] = numComponents;
+						stack[top++] = q;
+					}
+				}
+			}
+			numComponents += 1;
+		}
+	}
+
+	for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+	{
+		i32 head = solver->head[pipe];
+		i32 target = solver->target[pipe];
+		if (head == target || solverAdjacent(solver, head, target))
+			continue;
+
+		bool reachable = false;
+		for (i32 d = 0; d < 4; d++)
+		{
+			i32 p = head + solver->delta[d];
+			if (owner[p] != SOLVER_EMPTY)
+				continue;
+
+			for (i32 e = 0; e < 4; e++)
+			{
+				i32 q = target + solver->delta[e];
+				if (owner[q] == SOLVER_EMPTY && component[q] == component[p])
+				{
+					reachable = true;
+					solver->served[component[p]] = epoch;
+				}
+			}
+		}
+		if (!reachable)
+			return false;
+	}
+
+	for (i32 i = 0; i < numComponents; i++)
+	{
+		if (solver->served[i] != epoch)
+			return false;
+	}
+	return true;
+}
+
+// Makes every forced move there is, then guesses on the pipe with the
+// fewest moves. Returns with the solution in place, or with every move
+// since it was called taken back.
+static bool solverSearch(Solver *solver)
+{
+	solver->stats.nodes += 1;
+	if (solver->maxNodes > 0 && solver->stats.nodes > solver->maxNodes)
+	{
+		solver->aborted = true;
+		return false;
+	}
+
+	i32 mark = solver->numMoves;
+	i32 best = -1;
+	i32 bestCount = 0;
+	i32 bestMoves[4];
+	bool progressed = true;
+
+	while (progressed)
+	{
+		progressed = false;
+		best = -1;
+		for (i32 pipe = 0; pipe < solver->numPipes; pipe++)
+		{
+			if (solver->head[pipe] == solver->target[pipe])
+				continue;
+
+			i32 moves[4];
+			i32 count = solverMoves(solver, pipe, moves);
+			if (count == 0)
+			{
+				solverUndo(solver, mark);
+				return false;
+			}
+
+			if (count == 1)
+			{
+				solverMove(solver, pipe, moves[0]);
+				solver->stats.forced += 1;
+				progressed = true;
+			}
+			else if (best < 0 || count < bestCount)
+			{
+				best = pipe;
+				bestCount = count;
+				memcpy(bestMoves, moves, sizeof(i32) * count);
+			}
+		}
+	}
+
+	if (solver->numUnfinished == 0)
+	{
+		if (solver->numEmpty == 0)
+			return true;
+		solverUndo(solver, mark);
+		return false;
+	}
+
+	if (!solverPrune(solver))
+	{
+		solverUndo(solver, mark);
+		return false;
+	}
+
+	// cells with the fewest ways out first, they are the ones that would
+	// be left behind
+	i32 exits[4];
+	for (i32 i = 0; i < bestCount; i++)
+	{
+		exits[i] = 0;
+		for (i32 d = 0; d < 4; d++)
+		{
+			if (solver->owner[bestMoves[i] + solver->delta[d]] == SOLVER_EMPTY)
+				exits[i] += 1;
+		}
+		for (i32 j = i; j > 0 && exits[j] < exits[j - 1]; j--)
+		{
+			i32 swap = exits[j];
+			exits[j] = exits[j - 1];
+			exits[j - 1] = swap;
+			swap = bestMoves[j];
+			bestMoves[j] = bestMoves[j - 1];
+			bestMoves[j - 1] = swap;
+		}
+	}
+
+	solver->stats.branches += 1;
+	for (i32 i = 0; i < bestCount; i++)
+	{
+		i32 branchMark = solver->numMoves;
+		solverMove(solver, best, bestMoves[i]);
+		if (solverSearch(solver))
+			return true;
+
+		solverUndo(solver, branchMark);
+		if (solver->aborted)
+			break;
+	}
+
+	solverUndo(solver, mark);
+	return false;
+}
+
+bool solverSolve(Solver *solver, u64 maxNodes)
+{
+	u64 startTime = SDL_GetPerformanceCounter();
+	solver->maxNodes = maxNodes;
+	solver->aborted = false;
+	solver->stats = (SolveStats){0};
+
+	solver->stats.solved = solverSearch(solver);
+
+	u64 endTime = SDL_GetPerformanceCounter();
+	solver->stats.seconds
+	    = (endTime - startTime) / (f64)SDL_GetPerformanceFrequency();
+	return solver->stats.solved;
+}
+
+f64 solverDifficulty(const SolveStats *stats, i32 numCells)
+{
+	u64 decisions = stats->forced + stats->branches;
+	if (decisions == 0 || numCells == 0)
+		return 0.0;
+
+	f64 guessing = 100.0 * stats->branches / decisions;
+	f64 search = 10.0 * (stats->nodes - 1) / numCells;
+	return guessing + search;
+}
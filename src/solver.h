@@ -0,0 +1,97 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "arena.h"
+#include "board.h"
+
+// owner values of the solver grid that are not a pipe
+#define SOLVER_EMPTY -1
+#define SOLVER_WALL -2
+
+// what solving one puzzle took
+typedef struct
+{
+	bool solved;
+	// positions the search looked at
+	u64 nodes;
+	// moves that were the only one some pipe had left
+	u64 forced;
+	// positions where the search had to guess between two or more moves
+	u64 branches;
+	f64 seconds;
+} SolveStats;
+
+// one cell a pipe head moved onto, kept so the move can be undone
+typedef struct
+{
+	i32 cell;
+	i32 pipe;
+	i32 previousHead;
+} SolverMove;
+
+// Solves a puzzle from its endpoints. Every pipe grows from its
+// PIPE_START end towards its PIPE_END end, and like the pipes of the
+// generator it may not touch itself, so boards from boardGenerate always
+// have a solution the solver accepts.
+typedef struct
+{
+	i32 width;
+	i32 height;
+	i32 stride;
+	i32 numCells;
+	i32 delta[4];
+	i32 numPipes;
+
+	// which pipe covers each cell, laid out like the padded board cells
+	i32 *owner;
+	i32 *head;
+	i32 *target;
+	// the PIPE_START cell of every pipe, see solverFixPath
+	i32 *start;
+	i32 numUnfinished;
+	i32 numEmpty;
+
+	SolverMove *moves;
+	i32 numMoves;
+
+	// flood fill scratch, see solverPrune
+	u32 *visited;
+	u32 epoch;
+	i32 *component;
+	u32 *served;
+	i32 *stack;
+
+	u64 maxNodes;
+	bool aborted;
+	SolveStats stats;
+
+	Arena arena;
+} Solver;
+
+// False if the board is not a puzzle: every color needs exactly one
+// PIPE_START and one PIPE_END cell.
+bool solverInit(Solver *solver, Board *board);
+
+void solverFree(Solver *solver);
+
+// Lays a pipe the player drew before solving. cells[0] is one of the
+// pipe's endpoints and every cell after it is next to the one before; a
+// path from the PIPE_END end turns the pipe around, so the search grows it
+// from there. False, with nothing laid, if the cells are taken or not a
+// path.
+bool solverFixPath(Solver *solver, i32 pipe, const i32 *cells, i32 count);
+
+// Takes back every move and every fixed path, back to the endpoints.
+void solverReset(Solver *solver);
+
+// maxNodes 0 searches until the puzzle is solved or known to have no
+// solution; the result is also in solver->stats
+bool solverSolve(Solver *solver, u64 maxNodes);
+
+// A single number to sort puzzles by: 0 for one the forced moves alone
+// solve, growing with the share of guesses and with the search per cell.
+f64 solverDifficulty(const SolveStats *stats, i32 numCells);
+
+#endif
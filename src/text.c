@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "text.h"
+#include "mem.h"
+
+#define TEXT_NUM_CHARS (TEXT_LAST_CHAR - TEXT_FIRST_CHAR + 1)
+
+bool textAtlasInit(TextAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font)
+{
+	*atlas = (TextAtlas){0};
+
+	char chars[TEXT_NUM_CHARS + 1];
+	for (i32 i = 0; i < TEXT_NUM_CHARS; i++)
+		chars[i] = TEXT_FIRST_CHAR + i;
+	chars[TEXT_NUM_CHARS] = '\0';
+
+	SDL_Color white = {255, 255, 255, 255};
+	SDL_Surface *surf = TTF_RenderText_Blended(font, chars, white);
+	if (!surf)
+	{
+		fprintf(stderr, "TTF_RenderText: %s\n", TTF_GetError());
+		return false;
+	}
+	atlas->texture = memTexture(SDL_CreateTextureFromSurface(renderer, surf));
+	atlas->glyphWidth = surf->w / TEXT_NUM_CHARS;
+	atlas->glyphHeight = surf->h;
+	SDL_FreeSurface(surf);
+	if (!atlas->texture)
+	{
+		fprintf(stderr, "SDL_CreateTexture: %s\n", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+void textAtlasFree(TextAtlas *atlas)
+{
+	if (atlas->texture)
+		memDestroyTexture(atlas->texture);
+	*atlas = (TextAtlas){0};
+}
+
+SDL_Point textAtlasSize(TextAtlas *atlas, const char *text)
+{
+	return (SDL_Point){
+		(i32)strlen(text) * atlas->glyphWidth,
+		atlas->glyphHeight
+	};
+}
+
+void textAtlasDraw(TextAtlas *atlas, SDL_Renderer *renderer, const char *text,
+                   i32 x, i32 y, SDL_Color color)
+{
+	if (!atlas->texture)
+		return;
+
+	SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+	SDL_Rect src = {0, 0, atlas->glyphWidth, atlas->glyphHeight};
+	SDL_Rect dest = {x, y, atlas->glyphWidth, atlas->glyphHeight};
+	for (const char *c = text; *c; c++, dest.x += atlas->glyphWidth)
+	{
+		if (*c < TEXT_FIRST_CHAR || *c > TEXT_LAST_CHAR || *c == ' ')
+			continue;
+		src.x = (*c - TEXT_FIRST_CHAR) * atlas->glyphWidth;
+		SDL_RenderCopy(renderer, atlas->texture, &src, &dest);
+	}
+}
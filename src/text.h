@@ -0,0 +1,35 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "common.h"
+
+// the printable ASCII range the atlas holds, other characters are skipped
+#define TEXT_FIRST_CHAR ' '
+#define TEXT_LAST_CHAR '~'
+
+// Every printable character rendered once, in white, side by side in one
+// texture. Text that changes every frame, like the timer, is drawn from
+// it a glyph at a time, so it creates no textures and allocates nothing.
+// The font must be monospaced.
+typedef struct
+{
+	SDL_Texture *texture;
+	i32 glyphWidth;
+	i32 glyphHeight;
+} TextAtlas;
+
+bool textAtlasInit(TextAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font);
+
+void textAtlasFree(TextAtlas *atlas);
+
+// the size text takes on one line
+SDL_Point textAtlasSize(TextAtlas *atlas, const char *text);
+
+// draws text with its top left corner at (x, y)
+void textAtlasDraw(TextAtlas *atlas, SDL_Renderer *renderer, const char *text,
+                   i32 x, i32 y, SDL_Color color);
+
+#endif
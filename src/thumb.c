@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "thumb.h"
+#include "mem.h"
+#include "board.h"
+#include "camera.h"
+#include "draw.h"
+#include "palette.h"
+#include "pipemesh.h"
+
+// boards asked for on the command line may be no bigger than this a side
+#define THUMB_MAX_SIZE 1024
+
+#define THUMB_MAX_PATH 1024
+
+typedef struct
+{
+	const char *dir;
+	i32 px;
+	i32 size;
+	i32 count;
+	u64 firstSeed;
+	bool solution;
+	bool glyphs;
+
+	// only read once set up, so every worker shares it
+	Palette palette;
+
+	// the index of the next board to render
+	SDL_atomic_t next;
+	SDL_atomic_t failed;
+} ThumbQueue;
+
+// Everything a worker draws with is its own: the surface it renders into,
+// the software renderer drawing there and the pipe and cell caches
+// drawBoard keeps between frames.
+typedef struct
+{
+	ThumbQueue *queue;
+	SDL_Surface *surface;
+	SDL_Renderer *renderer;
+	PipeMesh mesh;
+	CellTexture cellTexture;
+
+	// seconds spent on each step, over every board the worker rendered
+	f64 generateSeconds;
+	f64 drawSeconds;
+	f64 encodeSeconds;
+} ThumbWorker;
+
+static f64 thumbSeconds(u64 start, u64 end)
+{
+	return (end - start) / (f64)SDL_GetPerformanceFrequency();
+}
+
+static bool thumbWorkerInit(ThumbWorker *worker, ThumbQueue *queue)
+{
+	*worker = (ThumbWorker){.queue = queue};
+	worker->surface = SDL_CreateRGBSurfaceWithFormat(0, queue->px, queue->px,
+	                                                 32, SDL_PIXELFORMAT_RGBA32);
+	if (worker->surface)
+		worker->renderer = SDL_CreateSoftwareRenderer(worker->surface);
+	if (!worker->renderer)
+	{
+		fprintf(stderr, "SDL_CreateSoftwareRenderer: %s\n", SDL_GetError());
+		return false;
+	}
+
+	i32 maxPipes = queue->size * queue->size / 3;
+	if (   !pipeMeshInit(&worker->mesh, maxPipes)
+	    || !cellTextureInit(&worker->cellTexture, worker->renderer,
+	                        queue->size, queue->size))
+	{
+		fprintf(stderr, "Failed to set up drawing for %ix%i boards\n",
+		        queue->size, queue->size);
+		return false;
+	}
+	return true;
+}
+
+static void thumbWorkerFree(ThumbWorker *worker)
+{
+	cellTextureFree(&worker->cellTexture);
+	pipeMeshFree(&worker->mesh);
+	if (worker->renderer)
+		SDL_DestroyRenderer(worker->renderer);
+	if (worker->surface)
+		SDL_FreeSurface(worker->surface);
+	worker->renderer = NULL;
+	worker->surface = NULL;
+}
+
+static bool thumbRender(ThumbWorker *worker, u64 seed)
+{
+	ThumbQueue *queue = worker->queue;
+	u64 start = SDL_GetPerformanceCounter();
+
+	Board *board = boardCreate(queue->size, queue->size);
+	board->seed = seed;
+	board->quiet = true;
+	// the generator's own solution, connections included, rather than
+	// solving the endpoints again
+	board->keepSolution = queue->solution;
+	bool generated = boardGenerate(board);
+	u64 generatedTime = SDL_GetPerformanceCounter();
+	worker->generateSeconds += thumbSeconds(start, generatedTime);
+	if (!generated)
+	{
+		fprintf(stderr, "Failed to generate a %ix%i board from seed %llu\n",
+		        queue->size, queue->size, (unsigned long long)seed);
+		boardFree(board);
+		return false;
+	}
+
+	// laid out as the play state lays out a window of the thumbnail's size
+	Camera camera;
+	cameraInit(&camera, drawBoardView(queue->px, queue->px),
+	           queue->size, queue->size);
+	pipeMeshTouch(&worker->mesh, -1);
+	cellTextureTouch(&worker->cellTexture, 0, queue->size - 1);
+
+	SDL_SetRenderDrawColor(worker->renderer, 50, 50, 50, 255);
+	SDL_RenderClear(worker->renderer);
+	drawBoard(worker->renderer, board->cells, queue->size, queue->size,
+	          &camera, &worker->cellTexture, &worker->mesh, &queue->palette,
+	          queue->glyphs);
+	SDL_RenderSetClipRect(worker->renderer, NULL);
+	// the software renderer batches too, the surface is only complete
+	// once the batch has run
+	SDL_RenderFlush(worker->renderer);
+	boardFree(board);
+	u64 drawnTime = SDL_GetPerformanceCounter();
+	worker->drawSeconds += thumbSeconds(generatedTime, drawnTime);
+
+	char path[THUMB_MAX_PATH];
+	snprintf(path, sizeof(path), "%s/flow_%i_%llu.png", queue->dir,
+	         queue->size, (unsigned long long)seed);
+	bool saved = IMG_SavePNG(worker->surface, path) == 0;
+	if (!saved)
+		fprintf(stderr, "Failed to save %s: %s\n", path, IMG_GetError());
+	worker->encodeSeconds += thumbSeconds(drawnTime,
+	                                      SDL_GetPerformanceCounter());
+	return saved;
+}
+
+static i32 thumbWorker(void *data)
+{
+	ThumbWorker *worker = data;
+	ThumbQueue *queue = worker->queue;
+	for (;;)
+	{
+		i32 index = SDL_AtomicAdd(&queue->next, 1);
+		if (index >= queue->count)
+			break;
+		if (!thumbRender(worker, queue->firstSeed + index))
+			SDL_AtomicIncRef(&queue->failed);
+	}
+	return 0;
+}
+
+i32 thumbMain(i32 argc, char *argv[])
+{
+	ThumbQueue queue = {
+		.dir = THUMB_DIR,
+		.px = THUMB_DEFAULT_PX,
+		.firstSeed = 1
+	};
+	i32 numWorkers = SDL_GetCPUCount();
+	u64 positional[3];
+	i32 numPositional = 0;
+
+	for (i32 i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			queue.dir = argv[++i];
+		else if (strcmp(argv[i], "--px") == 0 && i + 1 < argc)
+			queue.px = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			numWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--solution") == 0)
+			queue.solution = true;
+		else if (strcmp(argv[i], "--glyphs") == 0)
+			queue.glyphs = true;
+		else if (numPositional < 3)
+			positional[numPositional++] = strtoull(argv[i], NULL, 10);
+		else
+			numPositional = -1;
+	}
+	if (numPositional >= 2)
+	{
+		queue.size = positional[0] > THUMB_MAX_SIZE ? 0 : (i32)positional[0];
+		queue.count = positional[1] > INT32_MAX ? 0 : (i32)positional[1];
+	}
+	// boardGenerate would pick a random seed for 0
+	if (numPositional == 3)
+		queue.firstSeed = positional[2];
+	if (   numPositional < 2
+	    || queue.size < 3 || queue.count < 1 || queue.firstSeed == 0
+	    || queue.px < 8)
+	{
+		fprintf(stderr, "Usage: flow --thumbs [--out dir] [--px n] "
+		        "[--threads n] [--solution] [--glyphs] "
+		        "size count [first seed]\n");
+		return 1;
+	}
+	if (numWorkers < 1)
+		numWorkers = 1;
+	if (numWorkers > queue.count)
+		numWorkers = queue.count;
+
+	if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
+	{
+		fprintf(stderr, "SDL_image could not initialize! SDL_image Error: %s\n",
+		        IMG_GetError());
+		return 1;
+	}
+	paletteInit(&queue.palette, queue.size * queue.size / 3);
+	SDL_AtomicSet(&queue.next, 0);
+	SDL_AtomicSet(&queue.failed, 0);
+
+	ThumbWorker *workers = memAlloc(sizeof(ThumbWorker) * numWorkers);
+	bool ready = true;
+	for (i32 i = 0; i < numWorkers; i++)
+	{
+		if (!thumbWorkerInit(&workers[i], &queue))
+			ready = false;
+	}
+
+	// the calling thread is worker 0
+	u64 startTime = SDL_GetPerformanceCounter();
+	SDL_Thread **threads = memAlloc(sizeof(SDL_Thread*) * numWorkers);
+	for (i32 i = 1; i < numWorkers && ready; i++)
+	{
+		threads[i] = SDL_CreateThread(thumbWorker, "thumb", &workers[i]);
+	}
+	if (ready)
+		thumbWorker(&workers[0]);
+	for (i32 i = 1; i < numWorkers && ready; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+	}
+	f64 seconds = thumbSeconds(startTime, SDL_GetPerformanceCounter());
+
+	f64 generateSeconds = 0.0;
+	f64 drawSeconds = 0.0;
+	f64 encodeSeconds = 0.0;
+	for (i32 i = 0; i < numWorkers; i++)
+	{
+		generateSeconds += workers[i].generateSeconds;
+		drawSeconds += workers[i].drawSeconds;
+		encodeSeconds += workers[i].encodeSeconds;
+		thumbWorkerFree(&workers[i]);
+	}
+
+	i32 failed = SDL_AtomicGet(&queue.failed);
+	if (ready)
+	{
+		fprintf(stderr, "Rendered %i %ix%i thumbnails of %ix%i boards in "
+		        "%.2fs on %i threads (%.1f thumbnails/s), per thumbnail: "
+		        "generate %.2f ms, draw %.2f ms, encode %.2f ms; "
+		        "%i failed, thumbnails in %s\n",
+		        queue.count - failed, queue.px, queue.px, queue.size,
+		        queue.size, seconds, numWorkers,
+		        (queue.count - failed) / seconds,
+		        generateSeconds * 1000.0 / queue.count,
+		        drawSeconds * 1000.0 / queue.count,
+		        encodeSeconds * 1000.0 / queue.count,
+		        failed, queue.dir);
+	}
+
+	memFree(threads);
+	memFree(workers);
+	paletteFree(&queue.palette);
+	IMG_Quit();
+	return ready && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#ifndef THUMB_H
+#define THUMB_H
+
+#include "common.h"
+
+// where thumbnails go unless --out says otherwise, it must exist
+#define THUMB_DIR "."
+
+// pixels a side of a thumbnail unless --px says otherwise
+#define THUMB_DEFAULT_PX 256
+
+// Headless thumbnail renderer for level packs, run as:
+//   flow --thumbs [--out dir] [--px n] [--threads n] [--solution]
+//                 size count [first seed]
+// Generates count size x size boards from seeds first seed (1 by default)
+// on, draws each with drawBoard into a px x px surface and saves it as
+// dir/flow_<size>_<seed>.png. With --solution the pipes the generator laid
+// are kept and drawn too. Every worker thread has its own software
+// renderer and surface, so no display is needed, and encodes its own
+// PNGs. Reports thumbnails per second on stderr.
+i32 thumbMain(i32 argc, char *argv[]);
+
+#endif
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "trace.h"
+#include "mem.h"
+
+// scopes deeper than this are closed at the end of a dump without a name
+#define TRACE_MAX_DEPTH 64
+
+// what a ring slot holds, set with compare and swap so that only one
+// thread claims a slot
+typedef enum
+{
+	TRACESLOT_EMPTY,
+	// being set up by the thread that claimed it, not dumped
+	TRACESLOT_CLAIMED,
+	TRACESLOT_LIVE,
+	// its thread exited, dumped once more and then free
+	TRACESLOT_EXITED,
+	// dumped after its thread exited, the ring is kept for the next one
+	TRACESLOT_FREE
+} TraceSlot;
+
+SDL_atomic_t traceEnabled;
+
+static TraceBuffer *traceBuffers[TRACE_MAX_THREADS];
+static SDL_atomic_t traceSlots[TRACE_MAX_THREADS];
+static SDL_atomic_t traceNextId;
+static u64 traceStart;
+
+// the calling thread's ring, taken on its first event
+static _Thread_local TraceBuffer *traceLocal;
+static _Thread_local i32 traceLocalSlot;
+static _Thread_local bool traceFull;
+static _Thread_local char traceName[32];
+
+// a slot in from, claimed, or -1
+static i32 traceClaim(TraceSlot from)
+{
+	for (i32 i = 0; i < TRACE_MAX_THREADS; i++)
+	{
+		if (SDL_AtomicCAS(&traceSlots[i], from, TRACESLOT_CLAIMED))
+			return i;
+	}
+	return -1;
+}
+
+static TraceBuffer* traceThreadBuffer(void)
+{
+	if (traceLocal || traceFull)
+		return traceLocal;
+
+	// rings already dumped first, then new ones, and only when every slot
+	// has one the events of an exited thread that were not dumped yet
+	i32 slot = traceClaim(TRACESLOT_FREE);
+	if (slot < 0)
+		slot = traceClaim(TRACESLOT_EMPTY);
+	if (slot < 0)
+		slot = traceClaim(TRACESLOT_EXITED);
+
+	TraceBuffer *buffer = NULL;
+	if (slot >= 0)
+	{
+		buffer = traceBuffers[slot];
+		if (!buffer)
+			buffer = memCalloc(1, sizeof(TraceBuffer));
+	}
+	if (!buffer)
+	{
+		if (slot >= 0)
+			SDL_AtomicSet(&traceSlots[slot], TRACESLOT_EMPTY);
+		traceFull = true;
+		return NULL;
+	}
+
+	SDL_AtomicSet(&buffer->head, 0);
+	buffer->id = SDL_AtomicAdd(&traceNextId, 1) + 1;
+	if (traceName[0])
+		snprintf(buffer->name, sizeof(buffer->name), "%s", traceName);
+	else
+		snprintf(buffer->name, sizeof(buffer->name), "thread %i", buffer->id);
+	SDL_AtomicSetPtr((void**)&traceBuffers[slot], buffer);
+	SDL_AtomicSet(&traceSlots[slot], TRACESLOT_LIVE);
+	traceLocal = buffer;
+	traceLocalSlot = slot;
+	return buffer;
+}
+
+void traceSetEnabled(bool enabled)
+{
+	if (enabled && traceStart == 0)
+		traceStart = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&traceEnabled, enabled);
+}
+
+void traceThreadName(const char *name)
+{
+	// the ring itself waits for the thread's first event
+	snprintf(traceName, sizeof(traceName), "%s", name);
+	if (traceLocal)
+		snprintf(traceLocal->name, sizeof(traceLocal->name), "%s", name);
+}
+
+void traceThreadExit(void)
+{
+	if (traceLocal)
+		SDL_AtomicSet(&traceSlots[traceLocalSlot], TRACESLOT_EXITED);
+	traceLocal = NULL;
+	traceFull = false;
+	traceName[0] = '\0';
+}
+
+void traceRecord(const char *name, bool begin)
+{
+	TraceBuffer *buffer = traceThreadBuffer();
+	if (!buffer)
+		return;
+
+	i32 head = SDL_AtomicGet(&buffer->head);
+	buffer->events[head % TRACE_EVENTS] = (TraceEvent){
+		.name = name,
+		.time = SDL_GetPerformanceCounter(),
+		.begin = begin
+	};
+	SDL_AtomicSet(&buffer->head, head + 1);
+}
+
+// microseconds since tracing started, the unit trace_event wants, kept
+// down to the nanosecond
+static f64 traceMicros(u64 time, f64 frequency)
+{
+	return time > traceStart ? (time - traceStart) * 1e6 / frequency : 0.0;
+}
+
+static void traceDumpBuffer(FILE *file, TraceBuffer *buffer,
+                            TraceEvent *events, f64 frequency, u64 now)
+{
+	// read once, a ring an exited thread left may be taken over meanwhile
+	i32 id = buffer->id;
+	fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	        "\"tid\":%i,\"args\":{\"name\":\"%s\"}}", id, buffer->name);
+
+	// copied out first, the thread may still be writing
+	i32 head = SDL_AtomicGet(&buffer->head);
+	i32 first = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0;
+	for (i32 i = first; i < head; i++)
+		events[i - first] = buffer->events[i % TRACE_EVENTS];
+
+	// whatever the thread wrote meanwhile may have overwritten the oldest,
+	// including the slot it is writing right now, and a ring taken over
+	// starts again from nothing
+	i32 after = SDL_AtomicGet(&buffer->head);
+	i32 safe = after - TRACE_EVENTS + 1;
+	if (safe < first)
+		safe = first;
+	if (after < head)
+		safe = head;
+
+	// a ring that wrapped may start inside scopes, their ends are dropped
+	const char *open[TRACE_MAX_DEPTH];
+	i32 depth = 0;
+	for (i32 i = safe; i < head; i++)
+	{
+		TraceEvent *event = &events[i - first];
+		if (!event->begin && depth == 0)
+			continue;
+
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+		        "\"pid\":1,\"tid\":%i}", event->name, event->begin ? 'B' : 'E',
+		        traceMicros(event->time, frequency), id);
+
+		if (event->begin)
+		{
+			if (depth < TRACE_MAX_DEPTH)
+				open[depth] = event->name;
+			depth += 1;
+		}
+		else
+		{
+			depth -= 1;
+		}
+	}
+
+	// scopes still running, the dump itself among them when a key asked
+	// for it, end now
+	while (depth > 0)
+	{
+		depth -= 1;
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.3f,"
+		        "\"pid\":1,\"tid\":%i}",
+		        depth < TRACE_MAX_DEPTH ? open[depth] : "",
+		        traceMicros(now, frequency), id);
+	}
+}
+
+bool traceDump(const char *path)
+{
+	i32 numBuffers = 0;
+	for (i32 i = 0; i < TRACE_MAX_THREADS; i++)
+	{
+		TraceSlot slot = SDL_AtomicGet(&traceSlots[i]);
+		if (slot == TRACESLOT_LIVE || slot == TRACESLOT_EXITED)
+			numBuffers += 1;
+	}
+	if (numBuffers == 0)
+		return true;
+
+	FILE *file = fopen(path, "w");
+	TraceEvent *events = memAlloc(sizeof(TraceEvent) * TRACE_EVENTS);
+	if (!file || !events)
+	{
+		fprintf(stderr, "Failed to open %s for writing\n", path);
+		if (file)
+			fclose(file);
+		memFree(events);
+		return false;
+	}
+
+	f64 frequency = (f64)SDL_GetPerformanceFrequency();
+	u64 now = SDL_GetPerformanceCounter();
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+	        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	        "\"args\":{\"name\":\"flow\"}}");
+	for (i32 i = 0; i < TRACE_MAX_THREADS; i++)
+	{
+		// rings being set up are left out, exited ones are dumped a last
+		// time and then free for another thread
+		TraceSlot slot = SDL_AtomicGet(&traceSlots[i]);
+		if (slot != TRACESLOT_LIVE && slot != TRACESLOT_EXITED)
+			continue;
+		TraceBuffer *buffer = SDL_AtomicGetPtr((void**)&traceBuffers[i]);
+		traceDumpBuffer(file, buffer, events, frequency, now);
+		if (slot == TRACESLOT_EXITED)
+			SDL_AtomicCAS(&traceSlots[i], TRACESLOT_EXITED, TRACESLOT_FREE);
+	}
+	fprintf(file, "\n]}\n");
+
+	memFree(events);
+	bool written = fclose(file) == 0;
+	if (written)
+		fprintf(stderr, "Trace of %i threads written to %s\n", numBuffers, path);
+	return written;
+}
+
+void traceFree(void)
+{
+	SDL_AtomicSet(&traceEnabled, false);
+	for (i32 i = 0; i < TRACE_MAX_THREADS; i++)
+	{
+		memFree(traceBuffers[i]);
+		traceBuffers[i] = NULL;
+		SDL_AtomicSet(&traceSlots[i], TRACESLOT_EMPTY);
+	}
+	SDL_AtomicSet(&traceNextId, 0);
+	traceLocal = NULL;
+	traceFull = false;
+}
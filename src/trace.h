@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "common.h"
+
+// events kept per thread, older ones are overwritten
+#define TRACE_EVENTS 16384
+
+// rings at once; a thread that finds every one taken by a running thread
+// records nothing
+#define TRACE_MAX_THREADS 64
+
+#define TRACE_DUMP_PATH "trace.json"
+
+// a scope opening or closing, at a performance counter time
+typedef struct
+{
+	const char *name;
+	u64 time;
+	bool begin;
+} TraceEvent;
+
+// The ring of one thread. Only that thread writes to it, head counts
+// every event it ever wrote and is published after the event is.
+typedef struct
+{
+	TraceEvent events[TRACE_EVENTS];
+	SDL_atomic_t head;
+	i32 id;
+	char name[32];
+} TraceBuffer;
+
+// read on every traceBegin and traceEnd, set with traceSetEnabled
+extern SDL_atomic_t traceEnabled;
+
+void traceSetEnabled(bool enabled);
+
+// names the calling thread's track in the trace
+void traceThreadName(const char *name);
+
+// Gives the calling thread's ring up as it exits. Its events stay for the
+// next traceDump, after which, or once no other ring is left, another
+// thread takes the ring over.
+void traceThreadExit(void);
+
+void traceRecord(const char *name, bool begin);
+
+// name must outlive the trace, a string literal in practice
+static inline void traceBegin(const char *name)
+{
+	if (SDL_AtomicGet(&traceEnabled))
+		traceRecord(name, true);
+}
+
+static inline void traceEnd(const char *name)
+{
+	if (SDL_AtomicGet(&traceEnabled))
+		traceRecord(name, false);
+}
+
+// Writes every thread's events as Chrome trace_event JSON, which Perfetto
+// and chrome://tracing open. Threads may keep recording while it runs.
+bool traceDump(const char *path);
+
+// only once no other thread records any more
+void traceFree(void);
+
+#endif